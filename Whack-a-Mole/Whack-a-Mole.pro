@@ -8,12 +8,35 @@ CONFIG += c++11
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Debug messages are compiled out of release builds, not just filtered at run time
+CONFIG(release, debug|release): DEFINES += QT_NO_DEBUG_OUTPUT
+
 SOURCES += \
+    hardwarechannel.cpp \
+    latencystats.cpp \
+    logging.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    molegridwidget.cpp \
+    molescheduler.cpp \
+    sessionlog.cpp
 
 HEADERS += \
-    mainwindow.h
+    hardwarechannel.h \
+    latencystats.h \
+    logging.h \
+    mainwindow.h \
+    molegridwidget.h \
+    molescheduler.h \
+    sessionlog.h \
+    sessionlogformat.h \
+    spscqueue.h \
+    ../whackamole_hist.h
+
+include(engine.pri)
+
+# Binary interface shared with the kernel module
+INCLUDEPATH += $$PWD/..
 
 FORMS += \
     mainwindow.ui
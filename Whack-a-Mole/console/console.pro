@@ -0,0 +1,18 @@
+# Display-less game for cabinets that only have the LEDs and buttons, no Qt at run time
+
+QT       -= core gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+TARGET = whackamole-console
+
+include(../engine.pri)
+
+SOURCES += \
+    main.cpp \
+    ../sessionlog.cpp
+
+HEADERS += \
+    ../sessionlog.h \
+    ../sessionlogformat.h
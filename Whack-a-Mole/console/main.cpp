@@ -0,0 +1,338 @@
+#include "gameengine.h"
+#include "sessionlog.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+static const std::size_t READ_BATCH = 64;    // Records taken from the device per read()
+
+static void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --kernel-engine    let the kernel module run the game, only report it\n"
+        "  --rounds N         play N rounds and exit, 0 plays until SIGINT/SIGTERM (default 0)\n"
+        "  --wait             wait for a button press before every round\n"
+        "  --moles N          moles up at the same time (default 1)\n"
+        "  --spawn-ms N       time between two moles (default 1500)\n"
+        "  --spawn-curve C    fixed, poisson or accelerating, the kernel-run game is always fixed (default fixed)\n"
+        "  --log-dir DIR      log every game to DIR, see sessionlogformat.h (default off)\n"
+        "  -v                 print every press and decision\n", argv0);
+}
+
+// CLOCK_MONOTONIC in nanoseconds, the clock of the kernel's timestamps and of every deadline
+static std::int64_t now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+* The cabinet behind /dev/whackamole. LED changes made while one batch of records is handled
+* are merged and sent as a single WHACKAMOLE_IOC_SET_LEDS by flush(), like HardwareChannel
+* does once per event-loop turn.
+*/
+class Cabinet : public GameDevice
+{
+public:
+    explicit Cabinet(int fd) : fd(fd) {}
+
+    void startGame() override { ledMask = writtenLedMask = 0; request(WHACKAMOLE_IOC_GAME_START); }
+    void stopGame() override { ledMask = writtenLedMask = 0; request(WHACKAMOLE_IOC_GAME_STOP); }
+    void setLed(int index, bool on) override { setLeds(on ? ledMask | (std::uint64_t(1) << index) : ledMask & ~(std::uint64_t(1) << index)); }
+    void setLeds(std::uint64_t mask) override { ledMask = mask; }
+    void playPattern(const whackamole_led_pattern &pattern) override
+    {
+        whackamole_led_pattern arg = pattern;
+        request(WHACKAMOLE_IOC_SET_PATTERN, &arg);
+    }
+
+    // Sends the LED state to the kernel if it changed since the last time
+    void flush()
+    {
+        if (ledMask == writtenLedMask)
+            return;
+        __u64 mask = ledMask;
+        request(WHACKAMOLE_IOC_SET_LEDS, &mask);
+        writtenLedMask = ledMask;
+    }
+
+    /** Issues one ioctl, failures are reported and otherwise ignored like in the GUI
+    *   @param request The ioctl, see whackamole_uapi.h
+    *   @param arg Its argument, nullptr for none
+    */
+    void request(unsigned long request, void *arg = nullptr)
+    {
+        if (::ioctl(fd, request, arg) < 0)
+            std::fprintf(stderr, "ioctl %lx failed: %s\n", request, std::strerror(errno));
+    }
+
+private:
+    int fd;    // Descriptor of /dev/whackamole
+    std::uint64_t ledMask = 0;    // LED state requested by the game
+    std::uint64_t writtenLedMask = 0;    // LED state last sent to the kernel
+};
+
+/**
+* Prints what happens in a compact form and logs it. Used for both the game run here, through
+* GameListener, and the game run by the kernel, through the records it streams.
+*/
+class Status : public GameListener
+{
+public:
+    explicit Status(bool verbose) : verbose(verbose) {}
+
+    SessionLog sessionLog;    // Log of the game in progress
+    bool roundOver = false;    // The round ended since the flag was last cleared
+
+    // Starts the counters and the log of a new round
+    void begin(const whackamole_board &board, std::uint32_t flags)
+    {
+        hits = misses = timeouts = 0;
+        reactionUs = 0;
+        roundOver = false;
+        sessionLog.begin(board.rows, board.cols, flags);
+        std::printf("round %u started\n", ++rounds);
+        std::fflush(stdout);
+    }
+
+    /** Accounts one record of the game
+    *   @param event The record, from the engine or the kernel
+    */
+    void logged(const whackamole_event &event) override
+    {
+        sessionLog.append(event);
+        switch (event.type) {
+        case WHACKAMOLE_EVENT_HIT:
+            ++hits;
+            reactionUs += event.latency_us;
+            break;
+        case WHACKAMOLE_EVENT_MISS:
+            ++misses;
+            break;
+        case WHACKAMOLE_EVENT_TIMEOUT:
+            ++timeouts;
+            break;
+        case WHACKAMOLE_EVENT_GAME_OVER:
+            sessionLog.end();
+            roundOver = true;
+            std::printf("round %u over: score %d, %u hits, %u misses, %u timeouts, mean reaction %u ms\n",
+                        rounds, event.score, hits, misses, timeouts, hits ? unsigned(reactionUs / hits / 1000) : 0);
+            break;
+        }
+        if (verbose && event.type < sizeof(NAMES) / sizeof(NAMES[0]) && NAMES[event.type])
+            std::printf("  %s %u score %d\n", NAMES[event.type], event.button, event.score);
+        std::fflush(stdout);
+    }
+
+private:
+    static constexpr const char *NAMES[] = {"press", "shown", "hit", "miss", "timeout", nullptr, nullptr, "hidden"};    // Verbose names, indexed by enum whackamole_event_type
+
+    bool verbose;    // Print every record
+    unsigned rounds = 0;    // Rounds started so far
+    unsigned hits = 0, misses = 0, timeouts = 0;    // Counters of the round
+    std::uint64_t reactionUs = 0;    // Sum of the reaction times of the hits
+};
+
+constexpr const char *Status::NAMES[];
+
+/**
+* Plays whack-a-mole on the cabinet without a display. The game rules, the session log and
+* the device protocol are the GUI's, but the only dependencies are the C++ library and one
+* epoll loop over the device, a timerfd for the engine's deadlines and a signalfd, so the
+* game is up right after boot on the smallest boards.
+*/
+int main(int argc, char *argv[])
+{
+    bool kernelEngine = false;
+    bool waitForPress = false;
+    bool verbose = false;
+    long maxRounds = 0;
+    const char *logDir = nullptr;
+    GameRules rules;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--kernel-engine"))
+            kernelEngine = true;
+        else if (!std::strcmp(argv[i], "--wait"))
+            waitForPress = true;
+        else if (!std::strcmp(argv[i], "-v"))
+            verbose = true;
+        else if (!std::strcmp(argv[i], "--rounds") && hasValue)
+            maxRounds = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--moles") && hasValue)
+            rules.maxMoles = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--spawn-ms") && hasValue)
+            rules.spawnIntervalMs = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--spawn-curve") && hasValue && parseSpawnCurve(argv[i + 1], &rules.spawnCurve))
+            ++i;
+        else if (!std::strcmp(argv[i], "--log-dir") && hasValue)
+            logDir = argv[++i];
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (maxRounds < 0 || rules.maxMoles < 1 || rules.spawnIntervalMs < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    int fd = ::open("/dev/" WHACKAMOLE_DEVICE_NAME, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        std::perror("/dev/" WHACKAMOLE_DEVICE_NAME);
+        return 1;
+    }
+    whackamole_board board = {};
+    if (::ioctl(fd, WHACKAMOLE_IOC_GET_BOARD, &board) < 0) {
+        std::perror("WHACKAMOLE_IOC_GET_BOARD");
+        return 1;
+    }
+
+    // SIGINT and SIGTERM end the game cleanly through the loop instead of a handler
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (signalFd < 0 || timerFd < 0 || epollFd < 0) {
+        std::perror("whackamole-console");
+        return 1;
+    }
+    for (int source : {fd, timerFd, signalFd}) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = source;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, source, &ev);
+    }
+
+    Cabinet cabinet(fd);
+    Status status(verbose);
+    if (logDir) {
+        mkdir(logDir, 0755);
+        status.sessionLog.setDirectory(logDir);
+    }
+    GameEngine engine(cabinet, status, int(board.rows * board.cols), rules, std::uint32_t(now()));
+
+    long rounds = 0;
+    bool playing = false;
+    auto startRound = [&]() {
+        status.begin(board, kernelEngine ? std::uint32_t(SESSIONLOG_KERNEL_ENGINE) : 0);
+        playing = true;
+        if (kernelEngine) {    // The kernel times the round and the moles
+            whackamole_engine_config config = {};
+            config.duration_ms = rules.durationMs;
+            config.spawn_interval_ms = rules.spawnIntervalMs;
+            config.mole_window_ms = rules.moleWindowMs;
+            config.hit_points = rules.hitPoints;
+            config.miss_points = rules.missPoints;
+            config.timeout_points = rules.timeoutPoints;
+            config.max_moles = rules.maxMoles;
+            cabinet.request(WHACKAMOLE_IOC_ENGINE_START, &config);
+        } else {
+            engine.start(now());
+        }
+    };
+    auto awaitRound = [&]() {
+        if (!waitForPress) {
+            startRound();
+            return;
+        }
+        cabinet.request(WHACKAMOLE_IOC_GAME_START);    // Presses are only reported while a game is on
+        std::printf("press any button to start\n");
+        std::fflush(stdout);
+    };
+    awaitRound();
+
+    bool quit = false;
+    while (!quit) {
+        // Wake up for the engine's earliest deadline, the kernel-run game has none here
+        itimerspec deadline = {};
+        std::int64_t deadlineNs = playing && !kernelEngine ? engine.nextDeadline() : DeadlineQueue::NO_DEADLINE;
+        if (deadlineNs != DeadlineQueue::NO_DEADLINE) {
+            deadline.it_value.tv_sec = deadlineNs / 1000000000;
+            deadline.it_value.tv_nsec = deadlineNs % 1000000000;
+            if (!deadline.it_value.tv_sec && !deadline.it_value.tv_nsec)
+                deadline.it_value.tv_nsec = 1;    // Zero would disarm the timer
+        }
+        timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &deadline, nullptr);
+
+        epoll_event ready[3];
+        int count = epoll_wait(epollFd, ready, 3, -1);
+        if (count < 0 && errno != EINTR) {
+            std::perror("epoll_wait");
+            break;
+        }
+        bool expired = false;
+        for (int i = 0; i < count; ++i) {
+            if (ready[i].data.fd == signalFd) {
+                quit = true;
+            } else if (ready[i].data.fd == timerFd) {
+                std::uint64_t expirations;
+                expired = ::read(timerFd, &expirations, sizeof(expirations)) > 0;
+            }
+        }
+
+        // Presses go first on every wakeup, also when only the timer fired: a press the kernel
+        // logged before a deadline ran is then judged against the board at its IRQ time, not
+        // as a miss on the board the deadline left behind
+        whackamole_event events[READ_BATCH];
+        ssize_t len;
+        while ((len = ::read(fd, events, sizeof(events))) > 0) {
+            for (std::size_t j = 0; j < std::size_t(len) / sizeof(whackamole_event); ++j) {
+                const whackamole_event &event = events[j];
+                if (!playing) {
+                    if (event.type == WHACKAMOLE_EVENT_PRESS)
+                        startRound();    // The press that starts a round does not count
+                } else if (kernelEngine) {
+                    status.logged(event);
+                } else if (event.type == WHACKAMOLE_EVENT_PRESS) {
+                    engine.press(event.button, std::int64_t(event.timestamp_ns));    // Deadlines due by the IRQ run first
+                }
+            }
+        }
+        if (expired && playing && !kernelEngine)
+            engine.advanceTo(now());
+        cabinet.flush();    // Every LED change of this wakeup in one ioctl
+
+        if (status.roundOver) {
+            status.roundOver = false;
+            playing = false;
+            if (maxRounds && ++rounds >= maxRounds)
+                break;
+            awaitRound();
+            cabinet.flush();
+        }
+    }
+
+    if (playing) {
+        if (kernelEngine)
+            cabinet.request(WHACKAMOLE_IOC_GAME_STOP);    // The game over record is not waited for
+        else
+            engine.stop(now());
+    } else {
+        cabinet.request(WHACKAMOLE_IOC_GAME_STOP);
+    }
+    status.sessionLog.end();
+    ::close(epollFd);
+    ::close(timerFd);
+    ::close(signalFd);
+    ::close(fd);
+    return 0;
+}
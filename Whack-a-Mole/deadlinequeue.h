@@ -0,0 +1,110 @@
+#ifndef DEADLINEQUEUE_H
+#define DEADLINEQUEUE_H
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/**
+* Min-heap of absolute deadlines on a monotonic nanosecond clock.
+* Holds every mole show/hide/expiry deadline of a game, so any number of moles needs
+* one heap instead of one timer or thread each. It has no notion of the current time,
+* the owner decides when to run what is due, which keeps it usable with a virtual clock.
+* Cancellation is lazy: cancelled entries stay in the heap and are skipped when popped.
+*/
+class DeadlineQueue
+{
+public:
+    using Id = std::uint64_t;    // Handle of a scheduled callback, never 0
+    using Callback = std::function<void(std::int64_t deadlineNs)>;    // Receives the deadline it was scheduled for
+
+    static constexpr std::int64_t NO_DEADLINE = std::numeric_limits<std::int64_t>::max();    // nextDeadline() of an empty queue
+
+    /** Schedules a callback
+    *   @param deadlineNs When the callback is due
+    *   @param callback What to run, deadlines that are equal run in the order they were scheduled
+    *   @return Handle for cancel()
+    */
+    Id schedule(std::int64_t deadlineNs, Callback callback)
+    {
+        Id id = ++lastId;
+        heap.push(Entry{deadlineNs, id});
+        callbacks.emplace(id, std::move(callback));
+        return id;
+    }
+
+    /** Cancels a callback that has not run yet
+    *   @param id Handle returned by schedule(), 0 is ignored
+    *   @return True if the callback was still pending
+    */
+    bool cancel(Id id)
+    {
+        return callbacks.erase(id) > 0;
+    }
+
+    // Cancels every pending callback
+    void clear()
+    {
+        callbacks.clear();
+        heap = Heap();
+    }
+
+    bool isEmpty() const { return callbacks.empty(); }    // No callback pending
+    std::size_t size() const { return callbacks.size(); }    // # of pending callbacks
+
+    // Earliest pending deadline, NO_DEADLINE if nothing is pending
+    std::int64_t nextDeadline()
+    {
+        dropCancelled();
+        if (heap.empty())
+            return NO_DEADLINE;
+        return heap.top().deadlineNs;
+    }
+
+    /** Runs every callback due at the given time, earliest first.
+    *   Callbacks may schedule and cancel, anything they schedule at or before nowNs runs too.
+    *   @param nowNs The current time
+    *   @return # of callbacks run
+    */
+    std::size_t runDue(std::int64_t nowNs)
+    {
+        std::size_t ran = 0;
+        while (nextDeadline() <= nowNs) {
+            Entry entry = heap.top();
+            heap.pop();
+            auto it = callbacks.find(entry.id);
+            Callback callback = std::move(it->second);
+            callbacks.erase(it);    // Gone before it runs, so it may reschedule itself
+            callback(entry.deadlineNs);
+            ++ran;
+        }
+        return ran;
+    }
+
+private:
+    struct Entry {
+        std::int64_t deadlineNs;    // When the callback is due
+        Id id;    // Increases with every schedule(), breaks ties in FIFO order
+        bool operator>(const Entry &other) const
+        {
+            return deadlineNs != other.deadlineNs ? deadlineNs > other.deadlineNs : id > other.id;
+        }
+    };
+    using Heap = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>;
+
+    Heap heap;    // Every scheduled entry, including cancelled ones
+    std::unordered_map<Id, Callback> callbacks;    // Pending callbacks by handle
+    Id lastId = 0;    // Handle given to the last scheduled callback
+
+    // Pops cancelled entries off the top of the heap
+    void dropCancelled()
+    {
+        while (!heap.empty() && !callbacks.count(heap.top().id))
+            heap.pop();
+    }
+};
+
+#endif // DEADLINEQUEUE_H
@@ -0,0 +1,13 @@
+# UI-free game rules, shared by the game and the headless replay tool
+
+INCLUDEPATH += $$PWD $$PWD/..
+
+SOURCES += \
+    $$PWD/gameengine.cpp
+
+HEADERS += \
+    $$PWD/deadlinequeue.h \
+    $$PWD/fakedevice.h \
+    $$PWD/gamedevice.h \
+    $$PWD/gameengine.h \
+    $$PWD/../whackamole_uapi.h
@@ -0,0 +1,29 @@
+#ifndef FAKEDEVICE_H
+#define FAKEDEVICE_H
+
+#include <cstddef>
+
+#include "gamedevice.h"
+
+/**
+* In-memory board for headless runs. Keeps the LED state the engine asked for and counts
+* the commands, so replays can check what the cabinet would have shown.
+*/
+class FakeDevice : public GameDevice
+{
+public:
+    void startGame() override { running = true; ++starts; }
+    void stopGame() override { running = false; leds = 0; ++stops; }
+    void setLed(int index, bool on) override { setLeds(on ? leds | (std::uint64_t(1) << index) : leds & ~(std::uint64_t(1) << index)); }
+    void setLeds(std::uint64_t mask) override { if (running) leds = mask; ++ledWrites; }    // Ignored while stopped, like the kernel
+    void playPattern(const whackamole_led_pattern &) override { ++patterns; }    // Patterns never change the state the LEDs go back to
+
+    bool running = false;    // Between startGame() and stopGame()
+    std::uint64_t leds = 0;    // Bit i is set while LED i is on
+    std::size_t starts = 0;    // # of startGame() calls
+    std::size_t stops = 0;    // # of stopGame() calls
+    std::size_t ledWrites = 0;    // # of LED changes requested
+    std::size_t patterns = 0;    // # of LED patterns requested
+};
+
+#endif // FAKEDEVICE_H
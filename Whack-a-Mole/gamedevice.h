@@ -0,0 +1,25 @@
+#ifndef GAMEDEVICE_H
+#define GAMEDEVICE_H
+
+#include <cstdint>
+
+#include "whackamole_uapi.h"
+
+/**
+* What the game engine drives: the LEDs of a board and whether it accepts presses.
+* HardwareChannel implements it for the cabinet, FakeDevice for headless runs.
+* Presses flow the other way, the owner of the engine feeds them to GameEngine::press().
+*/
+class GameDevice
+{
+public:
+    virtual ~GameDevice() {}
+
+    virtual void startGame() = 0;    // Start accepting button presses
+    virtual void stopGame() = 0;    // Stop the game and turn every LED off
+    virtual void setLed(int index, bool on) = 0;    // Change one LED
+    virtual void setLeds(std::uint64_t mask) = 0;    // Replace the whole LED state, bit i drives LED i
+    virtual void playPattern(const whackamole_led_pattern &pattern) = 0;    // Animate one LED, it goes back to its setLed() state when the pattern ends
+};
+
+#endif // GAMEDEVICE_H
@@ -0,0 +1,291 @@
+#include "gameengine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// # of set bits
+static int bitCount(std::uint64_t mask)
+{
+    return __builtin_popcountll(mask);
+}
+
+// Index of the n-th set bit of a mask, counting from 0, the mask must have more than n bits set
+static int nthBit(std::uint64_t mask, int n)
+{
+    while (n-- > 0)
+        mask &= mask - 1;    // Drop the lowest set bit
+    return __builtin_ctzll(mask);
+}
+
+/** Looks up a spawn curve by name
+*   @param name "fixed", "poisson" or "accelerating"
+*   @param curve Receives the curve
+*   @return False if the name is unknown
+*/
+bool parseSpawnCurve(const char *name, GameRules::SpawnCurve *curve)
+{
+    if (!std::strcmp(name, "fixed"))
+        *curve = GameRules::SpawnCurve::Fixed;
+    else if (!std::strcmp(name, "poisson"))
+        *curve = GameRules::SpawnCurve::Poisson;
+    else if (!std::strcmp(name, "accelerating"))
+        *curve = GameRules::SpawnCurve::Accelerating;
+    else
+        return false;
+    return true;
+}
+
+/** Creates an engine, no round is running until start()
+*   @param device Board the LEDs are shown on
+*   @param listener Renders what happens
+*   @param buttons # of moles on the board
+*   @param rules Rules of every round
+*   @param seed Seed of the mole picker, equal seeds pick equal moles
+*/
+GameEngine::GameEngine(GameDevice &device, GameListener &listener, int buttons, const GameRules &rules, std::uint32_t seed) :
+    device(device), listener(listener), gameRules(rules), numButtons(buttons), random(seed), expiries(buttons, 0),
+    bonkEnds(buttons, 0), shownNs(buttons, 0)
+{
+}
+
+/** Starts a round
+*   @param nowNs Current time, the round and the first spawn are timed from it
+*/
+void GameEngine::start(std::int64_t nowNs)
+{
+    deadlines.clear();    // Nothing left over from the last round
+    std::fill(expiries.begin(), expiries.end(), 0);
+    std::fill(bonkEnds.begin(), bonkEnds.end(), 0);
+    moleMask = bonkMask = 0;
+    gameScore = 0;
+    eventSeq = 0;
+    roundStartNs = clockNs = nowNs;
+    running = true;
+    device.startGame();
+    listener.scoreChanged(gameScore);
+
+    deadlines.schedule(nowNs + gameRules.durationMs * NS_PER_MS, [this](std::int64_t deadlineNs) { finish(deadlineNs); });
+    deadlines.schedule(nowNs + spawnIntervalNs(nowNs), [this](std::int64_t deadlineNs) {
+        spawn(deadlineNs); });
+}
+
+/** Ends the round before its time is up
+*   @param nowNs Current time
+*/
+void GameEngine::stop(std::int64_t nowNs)
+{
+    if (running)
+        finish(nowNs);
+}
+
+/** Judges a press against the hole it landed on. Everything due by nowNs runs first, so a
+*   press always sees the board as it was at nowNs.
+*   @param button Index of the button or the clicked mole, presses outside the board are ignored
+*   @param nowNs Time of the press
+*/
+void GameEngine::press(int button, std::int64_t nowNs)
+{
+    if (button < 0 || button >= numButtons)
+        return;    // Not a hole of this board
+    advanceTo(nowNs);
+    if (!running)
+        return;    // Late press after the round ended
+
+    std::uint64_t bit = std::uint64_t(1) << button;
+    bool hit = moleMask & bit;    // Check if a mole was whacked
+    std::uint32_t latencyUs = hit ? std::uint32_t((nowNs - shownNs[button]) / 1000) : 0;    // Reaction time, like the kernel measures it
+    log(WHACKAMOLE_EVENT_PRESS, button, nowNs, latencyUs);
+    if (hit) {
+        listener.moleHit(button);    // Show the bonk
+        deadlines.cancel(expiries[button]);    // A whacked mole can't time out
+        expiries[button] = 0;
+        moleMask &= ~bit;
+        bonkMask |= bit;
+        device.setLed(button, false);    // The LED stays dark once the flash is over
+        flash(button, WHACKAMOLE_PATTERN_HIT_FLASH);
+        bonkEnds[button] = deadlines.schedule(nowNs + gameRules.bonkMs * NS_PER_MS, [this, button](std::int64_t) {
+            bonkEnds[button] = 0;
+            hideMole(button); });    // Hide the bonk shortly after
+        addScore(gameRules.hitPoints);
+        log(WHACKAMOLE_EVENT_HIT, button, nowNs, latencyUs);
+    } else {
+        addScore(gameRules.missPoints);
+        flash(button, WHACKAMOLE_PATTERN_MISS_FLASH);
+        log(WHACKAMOLE_EVENT_MISS, button, nowNs);
+    }
+}
+
+/** Runs every deadline that is due
+*   @param nowNs Current time
+*   @return # of deadlines run
+*/
+std::size_t GameEngine::advanceTo(std::int64_t nowNs)
+{
+    clockNs = std::max(clockNs, nowNs);
+    return deadlines.runDue(nowNs);
+}
+
+/** Picks the time to the next spawn from the spawn curve. Poisson draws from the mole picker,
+*   through std::log rather than a distribution, whose algorithm differs between standard
+*   libraries, so seeded games stay reproducible.
+*   @param deadlineNs When the current spawn is due
+*   @return Time to the next spawn, at least 1 ms
+*/
+std::int64_t GameEngine::spawnIntervalNs(std::int64_t deadlineNs)
+{
+    std::int64_t intervalNs = gameRules.spawnIntervalMs * NS_PER_MS;
+    switch (gameRules.spawnCurve) {
+    case GameRules::SpawnCurve::Fixed:
+        break;
+    case GameRules::SpawnCurve::Poisson: {
+        double uniform = (double(random()) + 0.5) / 4294967296.0;    // (0, 1), never 0
+        intervalNs = std::int64_t(-std::log(uniform) * double(intervalNs));
+        break;
+    }
+    case GameRules::SpawnCurve::Accelerating: {
+        std::int64_t durationNs = gameRules.durationMs * NS_PER_MS;
+        std::int64_t elapsedNs = std::min(std::max(deadlineNs - roundStartNs, std::int64_t(0)), durationNs);
+        std::int64_t finalNs = gameRules.finalSpawnIntervalMs * NS_PER_MS;
+        if (durationNs > 0)
+            intervalNs += std::int64_t(double(finalNs - intervalNs) * double(elapsedNs) / double(durationNs));    // The product overflows int64
+        break;
+    }
+    }
+    return intervalNs < NS_PER_MS ? NS_PER_MS : intervalNs;
+}
+
+/** Shows a mole and schedules the next spawn
+*   @param deadlineNs When this spawn was due, the next one is timed from it so late
+*   wakeups don't add up over the round
+*/
+void GameEngine::spawn(std::int64_t deadlineNs)
+{
+    if (clockNs - deadlineNs < gameRules.moleWindowMs * NS_PER_MS)
+        showMole(deadlineNs);    // Otherwise the mole would be gone already, catch up without charging a timeout
+    deadlines.schedule(deadlineNs + spawnIntervalNs(deadlineNs), [this](std::int64_t nextDeadlineNs) {
+        spawn(nextDeadlineNs); });
+}
+
+/** Shows a new random mole in a hole that has none and lights its LED. On a full board the
+*   oldest mole goes away first, without penalty.
+*   @param nowNs Time the mole pops up, its window starts here
+*/
+void GameEngine::showMole(std::int64_t nowNs)
+{
+    if (bitCount(moleMask) >= std::max(1, std::min(gameRules.maxMoles, numButtons))) {
+        int oldest = oldestMole();
+        log(WHACKAMOLE_EVENT_MOLE_HIDDEN, oldest, nowNs);
+        hideMole(oldest);
+    }
+
+    std::uint64_t holes = (numButtons < 64 ? (std::uint64_t(1) << numButtons) - 1 : ~std::uint64_t(0)) & ~moleMask;
+    int index = nthBit(holes, int(random() % std::uint32_t(bitCount(holes))));    // Plain modulo, distributions differ between standard libraries
+    if (bonkMask & (std::uint64_t(1) << index))
+        hideMole(index);    // The new mole takes the bonk's place
+    moleMask |= std::uint64_t(1) << index;
+    shownNs[index] = nowNs;
+    listener.moleShown(index);
+    log(WHACKAMOLE_EVENT_MOLE_SHOWN, index, nowNs);
+    expiries[index] = deadlines.schedule(nowNs + gameRules.moleWindowMs * NS_PER_MS, [this, index](std::int64_t deadlineNs) {
+        moleTimeout(index, deadlineNs); });
+    device.setLed(index, true);
+}
+
+/** Hides a mole and turns its LED off, or removes a bonk
+*   @param index Index of the hole
+*/
+void GameEngine::hideMole(int index)
+{
+    std::uint64_t bit = std::uint64_t(1) << index;
+    if (!((moleMask | bonkMask) & bit))
+        return;    // Nothing to hide
+
+    listener.moleHidden(index);
+    deadlines.cancel(expiries[index]);
+    deadlines.cancel(bonkEnds[index]);
+    expiries[index] = bonkEnds[index] = 0;
+    if (moleMask & bit)
+        device.setLed(index, false);    // A bonk's LED is already off
+    moleMask &= ~bit;
+    bonkMask &= ~bit;
+}
+
+// Index of the mole that has been up the longest, the board must have one up
+int GameEngine::oldestMole() const
+{
+    int oldest = -1;
+    for (std::uint64_t up = moleMask; up; up &= up - 1) {
+        int index = __builtin_ctzll(up);
+        if (oldest == -1 || shownNs[index] < shownNs[oldest])
+            oldest = index;
+    }
+    return oldest;
+}
+
+/** Takes a mole down when nobody whacked it in time
+*   @param index Index of the mole whose window ran out
+*   @param nowNs When the window ran out
+*/
+void GameEngine::moleTimeout(int index, std::int64_t nowNs)
+{
+    if (moleMask & (std::uint64_t(1) << index)) {
+        addScore(gameRules.timeoutPoints);
+        log(WHACKAMOLE_EVENT_TIMEOUT, index, nowNs);
+        hideMole(index);
+    }
+}
+
+/** Ends the round, turns the board off and reports the final score
+*   @param nowNs When the round ended
+*/
+void GameEngine::finish(std::int64_t nowNs)
+{
+    device.stopGame();
+    for (std::uint64_t shown = moleMask | bonkMask; shown; shown &= shown - 1)
+        hideMole(__builtin_ctzll(shown));
+    deadlines.clear();    // Stop spawning and forget every pending deadline
+    running = false;
+    log(WHACKAMOLE_EVENT_GAME_OVER, 0, nowNs);
+    listener.gameOver(gameScore);
+}
+
+/** Changes the score and reports it
+*   @param points Points to add, negative to deduct
+*/
+void GameEngine::addScore(int points)
+{
+    gameScore += points;
+    listener.scoreChanged(gameScore);
+}
+
+/** Asks the device for one of the flashes the kernel times on its own, one command instead
+*   of an LED change per blink
+*   @param button Button whose LED flashes
+*   @param kind WHACKAMOLE_PATTERN_HIT_FLASH or WHACKAMOLE_PATTERN_MISS_FLASH
+*/
+void GameEngine::flash(int button, whackamole_pattern_kind kind)
+{
+    whackamole_led_pattern pattern = {};
+    pattern.led = __u8(button);
+    pattern.kind = __u8(kind);
+    device.playPattern(pattern);
+}
+
+/** Reports a record to the listener, numbered and scored like the kernel numbers its own
+*   @param type What happened
+*   @param button Button or mole it happened to
+*   @param nowNs When it happened
+*   @param latencyUs Reaction time for presses on the mole that is up, 0 otherwise
+*/
+void GameEngine::log(whackamole_event_type type, int button, std::int64_t nowNs, std::uint32_t latencyUs)
+{
+    whackamole_event event = {};
+    event.seq = eventSeq++;
+    event.type = __u16(type);
+    event.button = __u16(button);
+    event.timestamp_ns = __u64(nowNs);
+    event.score = gameScore;
+    event.latency_us = latencyUs;
+    listener.logged(event);
+}
@@ -0,0 +1,115 @@
+#ifndef GAMEENGINE_H
+#define GAMEENGINE_H
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "deadlinequeue.h"
+#include "gamedevice.h"
+#include "whackamole_uapi.h"
+
+// Rules of a game, shared by the GUI-run, the kernel-run and the replayed game
+struct GameRules {
+    // How the time between two moles is picked
+    enum class SpawnCurve {
+        Fixed,    // Always spawnIntervalMs
+        Poisson,    // Exponentially distributed around a mean of spawnIntervalMs
+        Accelerating,    // spawnIntervalMs at the start, shrinking linearly to finalSpawnIntervalMs at the end of the round
+    };
+
+    int durationMs = 20000;    // Length of a round
+    int spawnIntervalMs = 1500;    // Time between two moles
+    SpawnCurve spawnCurve = SpawnCurve::Fixed;    // Only Fixed is supported by the kernel-run game
+    int finalSpawnIntervalMs = 500;    // Accelerating: time between two moles at the end of the round
+    int moleWindowMs = 1500;    // How long a mole stays up
+    int maxMoles = 1;    // Moles up at the same time, a spawn on a full board takes the oldest down
+    int bonkMs = 250;    // How long a whacked mole shows the bonk
+    int hitPoints = 3;    // Whacking the mole
+    int missPoints = -1;    // Whacking an empty hole
+    int timeoutPoints = -1;    // Letting a mole go
+};
+
+bool parseSpawnCurve(const char *name, GameRules::SpawnCurve *curve);    // "fixed", "poisson" or "accelerating"
+
+/**
+* Receives what the engine decided, so it can be rendered. Every method defaults to
+* doing nothing.
+*/
+class GameListener
+{
+public:
+    virtual ~GameListener() {}
+
+    virtual void moleShown(int index) { (void)index; }    // A mole popped up
+    virtual void moleHit(int index) { (void)index; }    // The mole was whacked, it shows the bonk until it is hidden
+    virtual void moleHidden(int index) { (void)index; }    // The mole or its bonk went away, or a new mole took the bonk's place
+    virtual void scoreChanged(int score) { (void)score; }    // A hit, miss or timeout changed the score
+    virtual void gameOver(int score) { (void)score; }    // The round ended
+    virtual void logged(const whackamole_event &event) { (void)event; }    // Every press and decision, as the record the kernel-run game would read
+};
+
+/**
+* The rules of whack-a-mole without any UI or clock of its own.
+* Time is whatever the caller says it is: deadlines live in a DeadlineQueue and only run
+* from advanceTo() and press(), so the GUI drives the engine from CLOCK_MONOTONIC and a
+* replay drives it from a virtual clock, millions of events per second, with identical
+* scoring. Every deadline is absolute and follows from the one before it, so the round and
+* the mole windows are exact and nothing drifts however late the caller wakes up. A spawn
+* that runs so late its mole would already be gone is skipped, not shown and timed out.
+* The board is a bitset, so any number of moles can be up at once, each with its own
+* deadline, and presses are judged per hole. Moles are picked by a seeded std::mt19937,
+* whose sequence is fixed by the standard, so a seed and a press trace always give the
+* same game.
+*/
+class GameEngine
+{
+public:
+    GameEngine(GameDevice &device, GameListener &listener, int buttons, const GameRules &rules = GameRules(), std::uint32_t seed = std::mt19937::default_seed);
+
+    const GameRules &rules() const { return gameRules; }    // Rules the engine plays by
+    void setRules(const GameRules &rules) { gameRules = rules; }    // Rules of the next round
+    int buttons() const { return numButtons; }    // # of moles on the board
+    int score() const { return gameScore; }    // Score of the current or last round
+    std::uint64_t moles() const { return moleMask; }    // Bit i is set while mole i is up
+    bool isRunning() const { return running; }    // Between start() and the end of the round
+
+    void start(std::int64_t nowNs);    // Start a round
+    void stop(std::int64_t nowNs);    // End the round early
+    void press(int button, std::int64_t nowNs);    // A button was pressed or a mole clicked
+    std::size_t advanceTo(std::int64_t nowNs);    // Run everything due by nowNs
+    std::int64_t nextDeadline() { return deadlines.nextDeadline(); }    // When advanceTo() has work next, DeadlineQueue::NO_DEADLINE if never
+    std::int64_t spawnIntervalNs(std::int64_t deadlineNs);    // Time from a spawn to the next one
+
+private:
+    static const std::int64_t NS_PER_MS = 1000000;
+
+    GameDevice &device;    // Board the LEDs are shown on
+    GameListener &listener;    // Renders what happens
+    GameRules gameRules;    // Rules of every round
+    int numButtons;    // # of moles on the board
+    std::mt19937 random;    // Picks the moles
+    DeadlineQueue deadlines;    // Spawns, expiries, bonks and the end of the round
+    std::vector<DeadlineQueue::Id> expiries;    // Pending expiry of each mole, 0 if it is not up
+    std::vector<DeadlineQueue::Id> bonkEnds;    // Pending removal of each bonk, 0 if there is none
+    std::vector<std::int64_t> shownNs;    // When each mole that is up popped up
+    std::uint64_t moleMask = 0;    // Bit i is set while mole i is up
+    std::uint64_t bonkMask = 0;    // Bit i is set while hole i shows a bonk
+    std::uint32_t eventSeq = 0;    // Sequence number of the next logged() record
+    std::int64_t roundStartNs = 0;    // When the round started
+    std::int64_t clockNs = 0;    // Time of the last start(), press() or advanceTo()
+    int gameScore = 0;    // Score of the round
+    bool running = false;    // A round is in progress
+
+    void spawn(std::int64_t deadlineNs);    // Show a mole and schedule the next spawn
+    void showMole(std::int64_t nowNs);    // Show a new random mole
+    void hideMole(int index);    // Hide a mole or a bonk
+    int oldestMole() const;    // Index of the mole that has been up the longest
+    void moleTimeout(int index, std::int64_t nowNs);    // A mole's window ran out
+    void finish(std::int64_t nowNs);    // End the round
+    void addScore(int points);    // Change the score and report it
+    void flash(int button, whackamole_pattern_kind kind);    // Play a fixed flash on a button's LED
+    void log(whackamole_event_type type, int button, std::int64_t nowNs, std::uint32_t latencyUs = 0);    // Report a record to logged()
+};
+
+#endif // GAMEENGINE_H
@@ -0,0 +1,285 @@
+#include "hardwarechannel.h"
+#include "logging.h"
+#include <QMetaObject>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <cerrno>
+#include <cstring>
+
+// Signals an eventfd, repeated signals before the other side reads it wake it only once
+static void signalEventFd(int eventFd)
+{
+    quint64 one = 1;
+    if (::write(eventFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        qCWarning(lcHardware) << "Signalling the I/O thread failed:" << strerror(errno);
+}
+
+// Resets an eventfd after it woke us
+static void clearEventFd(int eventFd)
+{
+    quint64 count;
+    if (::read(eventFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        qCWarning(lcHardware) << "Reading an eventfd failed:" << strerror(errno);
+}
+
+// Opens the device once, reads the board and hands the descriptor to the I/O thread
+HardwareChannel::HardwareChannel(QObject *parent) : QObject(parent), fd(-1), eventsReady(-1), commandsReady(-1),
+    notifier(nullptr), boardSize{2, 2}, lastEventSeq(-1), ledMask(0), writtenLedMask(0), flushScheduled(false), stopping(false)
+{
+    fd = ::open("/dev/" WHACKAMOLE_DEVICE_NAME, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        qCWarning(lcHardware) << "Unable to open /dev/" WHACKAMOLE_DEVICE_NAME ":" << strerror(errno);
+        return;
+    }
+
+    // Ask the kernel module for the size of the board, so the GUI grid matches the cabinet
+    if (::ioctl(fd, WHACKAMOLE_IOC_GET_BOARD, &boardSize) < 0) {
+        qCWarning(lcHardware) << "Unable to read the board size:" << strerror(errno);
+        boardSize = {2, 2};    // The original cabinet
+    }
+
+    eventsReady = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    commandsReady = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventsReady < 0 || commandsReady < 0) {
+        qCWarning(lcHardware) << "Unable to create the I/O thread's eventfds:" << strerror(errno);
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    notifier = new QSocketNotifier(eventsReady, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &HardwareChannel::drainEvents);
+    ioThread = std::thread(&HardwareChannel::ioLoop, this);
+}
+
+// Starts the game on the kernel side
+void HardwareChannel::startGame()
+{
+    ledMask = writtenLedMask = 0;    // The kernel ignored LED commands while stopped
+    command(WHACKAMOLE_IOC_GAME_START);
+}
+
+/** Starts a game run by the kernel. Moles, LEDs and hit judgement are handled in the
+*   module and reported through the mole and gameOver signals.
+*   @param config Rules of the game
+*/
+void HardwareChannel::startEngine(const whackamole_engine_config &config)
+{
+    ledMask = writtenLedMask = 0;    // The kernel owns the LEDs until the game ends
+    command(WHACKAMOLE_IOC_ENGINE_START, 0, &config);
+}
+
+// Stops the game on the kernel side, which also turns every LED off
+void HardwareChannel::stopGame()
+{
+    ledMask = writtenLedMask = 0;    // Anything still pending is superseded
+    command(WHACKAMOLE_IOC_GAME_STOP);
+}
+
+/** Changes a single LED
+*   @param index Index of the LED
+*   @param on True to turn the LED on
+*/
+void HardwareChannel::setLed(int index, bool on)
+{
+    setLeds(on ? ledMask | (1ull << index) : ledMask & ~(1ull << index));
+}
+
+/** Replaces the state of every LED. Calls made in the same event-loop turn are merged
+*   and only the final state is sent, as one ioctl.
+*   @param mask Bit i turns LED i on
+*/
+void HardwareChannel::setLeds(std::uint64_t mask)
+{
+    ledMask = mask;
+    if (!flushScheduled) {
+        flushScheduled = true;
+        QMetaObject::invokeMethod(this, "flushLeds", Qt::QueuedConnection);    // Runs once the current event has been handled
+    }
+}
+
+// Sends the LED state to the kernel if it changed since the last time
+void HardwareChannel::flushLeds()
+{
+    flushScheduled = false;
+    if (ledMask == writtenLedMask)
+        return;    // Changes cancelled each other out
+
+    command(WHACKAMOLE_IOC_SET_LEDS, ledMask);
+    writtenLedMask = ledMask;
+}
+
+/** Plays a pattern on one LED. It is sent right away, the kernel only changes the state the
+*   LED goes back to when LED commands for it arrive in between.
+*   @param pattern The pattern, see whackamole_uapi.h
+*/
+void HardwareChannel::playPattern(const whackamole_led_pattern &pattern)
+{
+    command(WHACKAMOLE_IOC_SET_PATTERN, 0, nullptr, &pattern);
+}
+
+// GUI thread: handles every event the I/O thread has queued since the last wakeup
+void HardwareChannel::drainEvents()
+{
+    if (!isOpen())
+        return;    // No device, no I/O thread, nothing to drain
+    clearEventFd(eventsReady);
+
+    whackamole_event event;
+    while (events.pop(event)) {
+        // The kernel numbers every event, a gap means we fell behind its log
+        if (lastEventSeq >= 0 && event.seq != quint32(lastEventSeq) + 1) {
+            qCWarning(lcHardware) << "Missed" << event.seq - quint32(lastEventSeq) - 1 << "button events";
+        }
+        lastEventSeq = event.seq;
+
+        emit eventRead(event);
+        switch (event.type) {
+        case WHACKAMOLE_EVENT_PRESS:
+            emit buttonPressed(event.button, event.timestamp_ns);
+            break;
+        case WHACKAMOLE_EVENT_MOLE_SHOWN:
+            emit moleShown(event.button);
+            break;
+        case WHACKAMOLE_EVENT_MOLE_HIDDEN:
+            emit moleHidden(event.button);
+            break;
+        case WHACKAMOLE_EVENT_HIT:
+            emit moleHit(event.button, event.score);
+            break;
+        case WHACKAMOLE_EVENT_MISS:
+            emit moleMissed(event.button, event.score);
+            break;
+        case WHACKAMOLE_EVENT_TIMEOUT:
+            emit moleTimedOut(event.button, event.score);
+            break;
+        case WHACKAMOLE_EVENT_GAME_OVER:
+            emit gameOver(event.score);
+            break;
+        case WHACKAMOLE_EVENT_PATTERN_DONE:
+            emit patternDone(event.button);
+            break;
+        }
+    }
+}
+
+/** Queues an ioctl for the I/O thread
+*   @param request The ioctl to issue, see whackamole_uapi.h
+*   @param mask Argument of WHACKAMOLE_IOC_SET_LEDS
+*   @param config Argument of WHACKAMOLE_IOC_ENGINE_START
+*   @param pattern Argument of WHACKAMOLE_IOC_SET_PATTERN
+*/
+void HardwareChannel::command(unsigned long request, __u64 mask, const whackamole_engine_config *config,
+                              const whackamole_led_pattern *pattern)
+{
+    if (fd < 0)
+        return;    // No hardware attached
+
+    Command cmd = {};
+    cmd.request = request;
+    cmd.mask = mask;
+    if (config)
+        cmd.config = *config;
+    if (pattern)
+        cmd.pattern = *pattern;
+    if (!commands.push(cmd)) {
+        qCWarning(lcHardware) << "I/O thread is not keeping up, dropped ioctl" << QString::number(request, 16);
+        return;
+    }
+    signalEventFd(commandsReady);
+}
+
+// I/O thread: sleeps until the kernel has records or the GUI has commands
+void HardwareChannel::ioLoop()
+{
+    pollfd fds[2] = {{fd, POLLIN, 0}, {commandsReady, POLLIN, 0}};
+    while (!stopping.load(std::memory_order_acquire)) {
+        bool full = events.freeSpace() == 0;
+        fds[0].events = full ? 0 : POLLIN;    // Leave records in the kernel while the GUI is behind
+        if (::poll(fds, 2, full ? 1 : -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            qCWarning(lcHardware) << "Waiting for /dev/" WHACKAMOLE_DEVICE_NAME " failed:" << strerror(errno);
+            return;
+        }
+        if (fds[1].revents & POLLIN)
+            clearEventFd(commandsReady);
+
+        Command cmd;
+        while (commands.pop(cmd))
+            execute(cmd);
+        if (fds[0].revents & (POLLIN | POLLERR | POLLHUP))
+            readDevice();
+    }
+}
+
+// I/O thread: moves every pending record into the events queue and wakes the GUI
+void HardwareChannel::readDevice()
+{
+    whackamole_event batch[16];    // The kernel only ever returns whole records
+    bool queued = false;
+    for (;;) {
+        size_t space = qMin(events.freeSpace(), sizeof(batch) / sizeof(batch[0]));
+        if (!space)
+            break;    // The GUI drains first
+        ssize_t len = ::read(fd, batch, space * sizeof(whackamole_event));
+        if (len <= 0) {
+            if (len < 0 && errno != EAGAIN && errno != EINTR) {
+                qCWarning(lcHardware) << "Reading /dev/" WHACKAMOLE_DEVICE_NAME " failed:" << strerror(errno);
+                stopping.store(true, std::memory_order_release);    // Stop spinning on a broken descriptor
+            }
+            break;
+        }
+        for (size_t i = 0; i < size_t(len) / sizeof(whackamole_event); ++i)
+            events.push(batch[i]);    // Fits, we never read more than the free space
+        queued = true;
+    }
+    if (queued)
+        signalEventFd(eventsReady);
+}
+
+/** I/O thread: issues one ioctl on the device
+*   @param command The ioctl and its argument
+*/
+void HardwareChannel::execute(const Command &command)
+{
+    Command arg = command;    // ioctl() wants a mutable argument
+    int ret;
+    switch (command.request) {
+    case WHACKAMOLE_IOC_SET_LEDS:
+        ret = ::ioctl(fd, command.request, &arg.mask);
+        break;
+    case WHACKAMOLE_IOC_ENGINE_START:
+        ret = ::ioctl(fd, command.request, &arg.config);
+        break;
+    case WHACKAMOLE_IOC_SET_PATTERN:
+        ret = ::ioctl(fd, command.request, &arg.pattern);
+        break;
+    default:
+        ret = ::ioctl(fd, command.request);
+        break;
+    }
+    if (ret < 0) {
+        qCWarning(lcHardware) << "ioctl" << QString::number(command.request, 16) << "failed:" << strerror(errno);
+    }
+}
+
+// Stops the I/O thread and closes the device
+HardwareChannel::~HardwareChannel()
+{
+    if (ioThread.joinable()) {
+        stopping.store(true, std::memory_order_release);
+        signalEventFd(commandsReady);
+        ioThread.join();
+    }
+    delete notifier;    // The notifier must go before its descriptor
+    if (eventsReady >= 0)
+        ::close(eventsReady);
+    if (commandsReady >= 0)
+        ::close(commandsReady);
+    if (fd >= 0)
+        ::close(fd);
+}
@@ -0,0 +1,91 @@
+#ifndef HARDWARECHANNEL_H
+#define HARDWARECHANNEL_H
+
+#include <QObject>
+#include <QSocketNotifier>
+
+#include <atomic>
+#include <thread>
+
+#include "gamedevice.h"
+#include "spscqueue.h"
+#include "whackamole_uapi.h"
+
+/**
+* Long-lived connection to the kernel module through /dev/whackamole.
+* A dedicated I/O thread owns the descriptor for the whole session: it reads event records
+* as the kernel queues them and issues the ioctls, so the GUI thread never makes a device
+* call that could stall painting or input. Decoded events reach the GUI through a lock-free
+* queue that is drained once per event-loop wakeup, commands go back through a second one.
+* Every LED change made during one event-loop turn is coalesced into a single atomic
+* WHACKAMOLE_IOC_SET_LEDS. This is the GameDevice of the GUI-run game.
+*/
+class HardwareChannel : public QObject, public GameDevice
+{
+    Q_OBJECT
+
+public:
+    explicit HardwareChannel(QObject *parent = nullptr);    // Opens the device and starts the I/O thread
+    virtual ~HardwareChannel();    // Stops the I/O thread and closes the device
+
+    bool isOpen() const { return fd >= 0; }    // False when no kernel module is loaded
+    whackamole_board board() const { return boardSize; }    // Layout the kernel module was loaded for, 2x2 without hardware
+
+    void startGame() override;    // Start accepting button presses
+    void startEngine(const whackamole_engine_config &config);    // Start a game run entirely by the kernel
+    void stopGame() override;    // Stop the game, the kernel also turns every LED off
+    void setLed(int index, bool on) override;    // Change one LED, applied at the end of the current event-loop turn
+    void setLeds(std::uint64_t mask) override;    // Replace the whole LED state, applied at the end of the current event-loop turn
+    void playPattern(const whackamole_led_pattern &pattern) override;    // Animate one LED, timed by the kernel
+
+signals:
+    void eventRead(const whackamole_event &event);    // Every record read from the kernel, before its own signal
+    void buttonPressed(int button, quint64 timestampNs);    // A button was pressed, timestamp is CLOCK_MONOTONIC
+
+    // Results of a game run by the kernel, score is the score after the event
+    void moleShown(int button);    // A mole popped up
+    void moleHidden(int button);    // The oldest mole went away to make room, no score change
+    void moleHit(int button, int score);    // The mole was whacked in time
+    void moleMissed(int button, int score);    // A button without a mole was pressed
+    void moleTimedOut(int button, int score);    // The mole went away untouched
+    void gameOver(int score);    // The round ended
+
+    void patternDone(int led);    // An LED pattern ran to its end
+
+public slots:
+    void drainEvents();    // GUI thread: handle every event the I/O thread decoded, also called before running deadlines
+
+private slots:
+    void flushLeds();    // Send the pending LED mask to the kernel
+
+private:
+    // One ioctl for the I/O thread to issue
+    struct Command {
+        unsigned long request;    // The ioctl, see whackamole_uapi.h
+        __u64 mask;    // Argument of WHACKAMOLE_IOC_SET_LEDS
+        whackamole_engine_config config;    // Argument of WHACKAMOLE_IOC_ENGINE_START
+        whackamole_led_pattern pattern;    // Argument of WHACKAMOLE_IOC_SET_PATTERN
+    };
+
+    int fd;    // Descriptor of /dev/whackamole, -1 if it could not be opened
+    int eventsReady;    // eventfd the I/O thread signals after queueing events
+    int commandsReady;    // eventfd the GUI signals after queueing commands or to stop the I/O thread
+    QSocketNotifier *notifier;    // Wakes the GUI when eventsReady is signalled
+    whackamole_board boardSize;    // Read once before the I/O thread starts
+    qint64 lastEventSeq;    // Sequence number of the last event from the kernel, -1 if none yet
+    quint64 ledMask;    // LED state requested by the game
+    quint64 writtenLedMask;    // LED state last sent to the kernel
+    bool flushScheduled;    // A flushLeds() call is already queued
+    SpscQueue<whackamole_event, 1024> events;    // I/O thread -> GUI
+    SpscQueue<Command, 256> commands;    // GUI -> I/O thread
+    std::atomic<bool> stopping;    // Tells the I/O thread to exit
+    std::thread ioThread;    // Owns fd while the channel is open
+
+    void command(unsigned long request, __u64 mask = 0, const whackamole_engine_config *config = nullptr,
+                 const whackamole_led_pattern *pattern = nullptr);    // Queue an ioctl for the I/O thread
+    void ioLoop();    // I/O thread: wait for records and commands
+    void readDevice();    // I/O thread: move pending records into the events queue
+    void execute(const Command &command);    // I/O thread: issue one ioctl
+};
+
+#endif // HARDWARECHANNEL_H
@@ -0,0 +1,43 @@
+#include "latencystats.h"
+
+// Creates empty statistics
+LatencyStats::LatencyStats(int buttons)
+{
+    reset(buttons);
+}
+
+/** Drops every sample
+*   @param buttons Number of buttons to keep statistics for
+*/
+void LatencyStats::reset(int buttons)
+{
+    perButton.fill(Button(), buttons);
+}
+
+/** Accounts one sample
+*   @param button Index of the button the sample belongs to, out of range samples are ignored
+*   @param latencyUs The latency in microseconds
+*/
+void LatencyStats::record(int button, quint64 latencyUs)
+{
+    if (button < 0 || button >= perButton.size())
+        return;
+
+    Button &stats = perButton[button];
+    stats.buckets[whackamole_hist_bucket(latencyUs)]++;
+    stats.count++;
+}
+
+// Formats the statistics with the same columns as /proc/whackamole_stats
+QString LatencyStats::table() const
+{
+    QString text = QStringLiteral(WHACKAMOLE_HIST_TABLE_HEADER);
+    for (int i = 0; i < perButton.size(); ++i) {
+        const Button &stats = perButton[i];
+        text += QString("%1 %2 %3 %4 %5 %6\n").arg(i).arg(stats.count).arg(stats.count)
+                .arg(whackamole_hist_percentile(stats.buckets.constData(), stats.count, 50))
+                .arg(whackamole_hist_percentile(stats.buckets.constData(), stats.count, 95))
+                .arg(whackamole_hist_percentile(stats.buckets.constData(), stats.count, 99));
+    }
+    return text;
+}
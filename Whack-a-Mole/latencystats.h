@@ -0,0 +1,30 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <QString>
+#include <QVector>
+
+#include "whackamole_hist.h"
+
+/**
+* Per-button latency histograms, bucketed exactly like the kernel's /proc/whackamole_stats
+* so both tables can be compared line by line.
+*/
+class LatencyStats
+{
+public:
+    explicit LatencyStats(int buttons = 0);    // Empty statistics for the given number of buttons
+
+    void reset(int buttons);    // Drop every sample and resize for the given number of buttons
+    void record(int button, quint64 latencyUs);    // Account one sample
+    QString table() const;    // Text table in the WHACKAMOLE_HIST_TABLE_HEADER layout
+
+private:
+    struct Button {
+        quint32 count = 0;    // Samples recorded
+        QVector<__u32> buckets = QVector<__u32>(WHACKAMOLE_HIST_BUCKETS, 0);    // Histogram of the samples
+    };
+    QVector<Button> perButton;    // Statistics of each button
+};
+
+#endif // LATENCYSTATS_H
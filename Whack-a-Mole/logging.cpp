@@ -0,0 +1,6 @@
+#include "logging.h"
+
+// Info and above by default, so per-event debug messages cost one flag test when they are compiled in
+Q_LOGGING_CATEGORY(lcGame, "whackamole.game", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcHardware, "whackamole.hardware", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcScheduler, "whackamole.scheduler", QtInfoMsg)
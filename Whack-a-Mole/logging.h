@@ -0,0 +1,13 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+// Logging categories of the game. Debug messages are off unless enabled at run time, e.g.
+//   QT_LOGGING_RULES="whackamole.*.debug=true" ./Whack-a-Mole
+// and compiled out entirely in release builds, see QT_NO_DEBUG_OUTPUT in Whack-a-Mole.pro.
+Q_DECLARE_LOGGING_CATEGORY(lcGame)    // whackamole.game: presses, hits and scores
+Q_DECLARE_LOGGING_CATEGORY(lcHardware)    // whackamole.hardware: /dev/whackamole
+Q_DECLARE_LOGGING_CATEGORY(lcScheduler)    // whackamole.scheduler: the mole timer
+
+#endif // LOGGING_H
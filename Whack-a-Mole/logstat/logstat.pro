@@ -0,0 +1,18 @@
+# Summaries of session logs, see ../sessionlogformat.h
+
+QT       -= core gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+TARGET = whackamole-logstat
+
+INCLUDEPATH += $$PWD/.. $$PWD/../..
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../sessionlogformat.h \
+    ../../whackamole_hist.h \
+    ../../whackamole_uapi.h
@@ -0,0 +1,219 @@
+#include "sessionlogformat.h"
+#include "whackamole_hist.h"
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Totals of one mole over every scanned session
+struct MoleStats {
+    std::uint64_t shown = 0;    // Times it popped up
+    std::uint64_t hits = 0;    // Times it was whacked in time
+    std::uint64_t misses = 0;    // Presses on its button while it was down
+    std::uint64_t timeouts = 0;    // Times it went away untouched
+    std::uint64_t reactions = 0;    // Samples in the histogram
+    std::vector<__u64> reactionBuckets = std::vector<__u64>(WHACKAMOLE_HIST_BUCKETS, 0);    // Reaction times of the hits, 64-bit like the other totals
+};
+
+// Summary of one session file
+struct Session {
+    std::string path;
+    std::int64_t startRealtimeNs = 0;
+    std::int64_t durationNs = 0;    // First to last record
+    std::uint32_t rows = 0, cols = 0, flags = 0;
+    std::uint64_t records = 0, moles = 0, hits = 0, misses = 0, timeouts = 0;
+    std::int32_t finalScore = 0;
+    bool finished = false;    // Has its game over record
+};
+
+static std::vector<MoleStats> moles;    // Indexed by button
+static std::vector<Session> sessions;
+static std::uint64_t totalRecords = 0;
+static std::uint64_t totalBytes = 0;
+static std::uint64_t skippedFiles = 0;
+
+/** Maps one session log and accounts every record. The records are used in place.
+*   @param path File to scan
+*   @return True if it is a session log
+*/
+static bool scanFile(const char *path)
+{
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || std::size_t(st.st_size) < sizeof(SessionLogHeader)) {
+        ::close(fd);
+        return false;
+    }
+    std::size_t size = std::size_t(st.st_size);
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // The mapping keeps the file
+    if (map == MAP_FAILED) {
+        std::perror(path);
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const SessionLogHeader *header = static_cast<const SessionLogHeader *>(map);
+    if (std::memcmp(header->magic, SESSIONLOG_MAGIC, sizeof(header->magic)) || header->version != SESSIONLOG_VERSION
+            || header->headerSize < sizeof(SessionLogHeader) || header->recordSize != sizeof(SessionLogRecord)
+            || header->headerSize > size) {
+        munmap(map, size);
+        return false;
+    }
+
+    const SessionLogRecord *records = reinterpret_cast<const SessionLogRecord *>(static_cast<const char *>(map) + header->headerSize);
+    std::size_t count = (size - header->headerSize) / header->recordSize;    // A torn last record is ignored
+
+    Session session;
+    session.path = path;
+    session.startRealtimeNs = header->startRealtimeNs;
+    session.rows = header->rows;
+    session.cols = header->cols;
+    session.flags = header->flags;
+    session.records = count;
+    for (std::size_t i = 0; i < count; ++i) {
+        const SessionLogRecord &record = records[i];
+        if (record.button >= moles.size())
+            moles.resize(record.button + 1u);
+        MoleStats &mole = moles[record.button];
+        switch (record.type) {
+        case WHACKAMOLE_EVENT_MOLE_SHOWN:
+            ++mole.shown;
+            ++session.moles;
+            break;
+        case WHACKAMOLE_EVENT_HIT:
+            ++mole.hits;
+            ++session.hits;
+            ++mole.reactions;
+            ++mole.reactionBuckets[whackamole_hist_bucket(record.latencyUs)];
+            break;
+        case WHACKAMOLE_EVENT_MISS:
+            ++mole.misses;
+            ++session.misses;
+            break;
+        case WHACKAMOLE_EVENT_TIMEOUT:
+            ++mole.timeouts;
+            ++session.timeouts;
+            break;
+        case WHACKAMOLE_EVENT_GAME_OVER:
+            session.finished = true;
+            break;
+        }
+        session.finalScore = record.score;
+    }
+    if (count)
+        session.durationNs = records[count - 1].timestampNs - records[0].timestampNs;
+
+    totalRecords += count;
+    totalBytes += size;
+    sessions.push_back(session);
+    munmap(map, size);
+    return true;
+}
+
+// nftw() callback, scans every session log below the given directories
+static int visit(const char *path, const struct stat *st, int type, struct FTW *)
+{
+    std::size_t len = std::strlen(path), suffixLen = std::strlen(SESSIONLOG_SUFFIX);
+    if (type == FTW_F && S_ISREG(st->st_mode) && len > suffixLen && !std::strcmp(path + len - suffixLen, SESSIONLOG_SUFFIX)) {
+        if (!scanFile(path))
+            ++skippedFiles;
+    }
+    return 0;
+}
+
+static void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [-s] PATH...\n"
+        "  Summarizes session logs (*" SESSIONLOG_SUFFIX "), directories are scanned recursively.\n"
+        "  -s   also print one line per session\n", argv0);
+}
+
+int main(int argc, char *argv[])
+{
+    bool perSession = false;
+    std::vector<const char *> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "-s"))
+            perSession = true;
+        else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    for (const char *path : paths) {
+        struct stat st;
+        if (stat(path, &st) < 0) {
+            std::perror(path);
+            continue;
+        }
+        if (S_ISDIR(st.st_mode))
+            nftw(path, visit, 32, FTW_PHYS);
+        else if (!scanFile(path))
+            ++skippedFiles;    // Named explicitly, so scanned whatever its suffix
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    if (perSession) {
+        std::sort(sessions.begin(), sessions.end(), [](const Session &a, const Session &b) {
+            return a.startRealtimeNs < b.startRealtimeNs; });
+        std::printf("%-19s %5s %6s %7s %6s %5s %6s %8s %6s  %s\n",
+                    "start", "board", "engine", "time_s", "moles", "hits", "misses", "timeouts", "score", "file");
+        for (const Session &session : sessions) {
+            char start[32];
+            time_t seconds = time_t(session.startRealtimeNs / 1000000000);
+            tm local;
+            localtime_r(&seconds, &local);
+            strftime(start, sizeof(start), "%Y-%m-%d %H:%M:%S", &local);
+            char board[16];
+            std::snprintf(board, sizeof(board), "%ux%u", session.rows, session.cols);
+            std::printf("%-19s %5s %6s %7.1f %6llu %5llu %6llu %8llu %6d%s %s\n", start, board,
+                        session.flags & SESSIONLOG_KERNEL_ENGINE ? "kernel" : "gui", session.durationNs / 1e9,
+                        (unsigned long long)session.moles, (unsigned long long)session.hits,
+                        (unsigned long long)session.misses, (unsigned long long)session.timeouts,
+                        session.finalScore, session.finished ? " " : "*", session.path.c_str());
+        }
+        std::printf("(* = no game over record, the game was cut short)\n\n");
+    }
+
+    std::printf("mole    shown     hits hit_rate   misses timeouts  p50_us  p95_us  p99_us\n");
+    for (std::size_t i = 0; i < moles.size(); ++i) {
+        const MoleStats &mole = moles[i];
+        if (!mole.shown && !mole.misses)
+            continue;
+        std::printf("%4zu %8llu %8llu %7.1f%% %8llu %8llu %7llu %7llu %7llu\n", i,
+                    (unsigned long long)mole.shown, (unsigned long long)mole.hits,
+                    mole.shown ? 100.0 * mole.hits / mole.shown : 0.0,
+                    (unsigned long long)mole.misses, (unsigned long long)mole.timeouts,
+                    (unsigned long long)whackamole_hist_percentile64(mole.reactionBuckets.data(), mole.reactions, 50),
+                    (unsigned long long)whackamole_hist_percentile64(mole.reactionBuckets.data(), mole.reactions, 95),
+                    (unsigned long long)whackamole_hist_percentile64(mole.reactionBuckets.data(), mole.reactions, 99));
+    }
+    std::printf("\n%zu sessions, %llu records, %.1f MB in %.3f s", sessions.size(), (unsigned long long)totalRecords,
+                totalBytes / 1e6, seconds);
+    if (skippedFiles)
+        std::printf(", %llu files skipped", (unsigned long long)skippedFiles);
+    std::printf("\n");
+    return 0;
+}
@@ -1,11 +1,34 @@
 #include "mainwindow.h"
 
 #include <QApplication>
+#include <QStandardPaths>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
     MainWindow w;
+    w.setKernelEngine(a.arguments().contains("--kernel-engine"));    // Let the kernel module run the game
+
+    // Every game is logged, --log-dir picks the directory and --log-dir "" turns logging off
+    QString logDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/sessions";
+    int logDirArg = a.arguments().indexOf("--log-dir");
+    if (logDirArg >= 0 && logDirArg + 1 < a.arguments().size())
+        logDir = a.arguments().at(logDirArg + 1);
+    w.setLogDirectory(logDir);
+
+    // High-intensity modes: --moles N moles up at once, --spawn-ms N between two moles,
+    // --spawn-curve fixed|poisson|accelerating
+    GameRules rules;
+    int molesArg = a.arguments().indexOf("--moles");
+    if (molesArg >= 0 && molesArg + 1 < a.arguments().size())
+        rules.maxMoles = qMax(1, a.arguments().at(molesArg + 1).toInt());
+    int spawnArg = a.arguments().indexOf("--spawn-ms");
+    if (spawnArg >= 0 && spawnArg + 1 < a.arguments().size())
+        rules.spawnIntervalMs = qMax(1, a.arguments().at(spawnArg + 1).toInt());
+    int curveArg = a.arguments().indexOf("--spawn-curve");
+    if (curveArg >= 0 && curveArg + 1 < a.arguments().size())
+        parseSpawnCurve(a.arguments().at(curveArg + 1).toUtf8().constData(), &rules.spawnCurve);
+    w.setRules(rules);
     // w.setFixedSize(400, 400);
     w.show();
     return a.exec();
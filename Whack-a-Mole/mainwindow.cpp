@@ -1,31 +1,73 @@
 #include "mainwindow.h"
 #include <QRandomGenerator>
 #include <QVBoxLayout>
-#include <QGridLayout>
 #include <QPushButton>
 #include <QLabel>
-#include <QTimer>
-#include <QDebug>
-#include <QThread>
+#include "logging.h"
+#include <QDir>
 
-// Constructor for MainWindow initializes the game UI, sets up timers for moles
-MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), score(0), currentMole(-1)
+static const qint64 NS_PER_MS = 1000000;
+
+// Constructor for MainWindow initializes the game UI, sets up the game engine and the mole scheduler
+MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), score(0), kernelMoles(0), kernelEngine(false), hardware(new HardwareChannel(this)),
+    engine(nullptr), scheduler(new MoleScheduler(this)), engineWakeup(0)
 {
     setupUi();  // set up the UI
+    engine = new GameEngine(*hardware, *this, moleGrid->cellCount(), GameRules(), QRandomGenerator::global()->generate());
+
+    // Button presses on the cabinet whack moles just like clicks
+    connect(hardware, &HardwareChannel::buttonPressed, this, [this](int button, quint64 timestampNs) {
+        qCDebug(lcGame) << "Button pressed:" << button;
+        dispatchLatency.record(button, (MoleScheduler::now() - timestampNs) / 1000);    // IRQ -> moleWhacked
+        if (!kernelEngine)
+            moleWhacked(button, qint64(timestampNs)); });    // Judged at the IRQ, like the console does
+
+    // Results of a game run by the kernel
+    connect(hardware, &HardwareChannel::moleShown, this, &MainWindow::engineMoleShown);
+    connect(hardware, &HardwareChannel::moleHidden, this, [this](int index) {
+        kernelMoles &= ~(1ull << index);
+        moleGrid->setCell(index, MoleGridWidget::Empty); });    // The kernel made room for a new mole
+    connect(hardware, &HardwareChannel::moleHit, this, &MainWindow::engineMoleHit);
+    connect(hardware, &HardwareChannel::moleMissed, this, [this](int, int newScore) { engineScoreChanged(newScore); });
+    connect(hardware, &HardwareChannel::moleTimedOut, this, [this](int index, int newScore) {
+        kernelMoles &= ~(1ull << index);
+        moleGrid->setCell(index, MoleGridWidget::Empty);    // Remove the mole
+        engineScoreChanged(newScore); });
+    connect(hardware, &HardwareChannel::gameOver, this, &MainWindow::engineGameOver);
+    connect(hardware, &HardwareChannel::eventRead, this, [this](const whackamole_event &event) {
+        if (kernelEngine)
+            sessionLog.append(event); });    // The GUI-run game is logged by the engine
+}
 
-    // Create and configure timers for each mole button
-    for(int i = 0; i < moleButtons.size(); ++i){
-        QTimer *timer = new QTimer(this);
-        timer->setInterval(1500);   // Moles pop up for 1.5 second
-        connect(timer, &QTimer::timeout, [this, i]() {
-            moleTimeout(i); });  // Connect timeout signal to handler
-        moleVisibilityTimers.push_back(timer);  // Store the timer in a list
+/** Chooses who runs the game. Without /dev/whackamole the GUI runs it, a kernel-run game
+*   could never start or end.
+*   @param enabled True to let the kernel module pick moles, judge hits and keep the score
+*/
+void MainWindow::setKernelEngine(bool enabled)
+{
+    if (enabled && !hardware->isOpen()) {
+        qCWarning(lcGame) << "No kernel module to run the game, the GUI runs it instead";
+        enabled = false;
     }
+    kernelEngine = enabled;
+}
+
+/** Chooses where games are logged, see sessionlogformat.h
+*   @param path Directory that gets one file per game, empty to disable logging
+*/
+void MainWindow::setLogDirectory(const QString &path)
+{
+    if (!path.isEmpty())
+        QDir().mkpath(path);
+    sessionLog.setDirectory(path.toStdString());
+}
 
-    // Set up polling timer for proc file
-    QTimer *pollTimer = new QTimer(this);
-    connect(pollTimer, &QTimer::timeout, this, &MainWindow::pollProcFile);  // Connect the timer's timeout signal to the polling function
-    pollTimer->start(100);  // Start the timer to poll every 100 milliseconds
+/** Changes the rules, the game in progress keeps its own
+*   @param rules Rules of every following game
+*/
+void MainWindow::setRules(const GameRules &rules)
+{
+    engine->setRules(rules);
 }
 
 // Sets up user interface, initializes widgets, sets up game logic timers and connect signals
@@ -33,194 +75,184 @@ void MainWindow::setupUi()
 {
     QWidget *centralWidget = new QWidget(this);     // Create the central widget
     QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget);   // Main layout for the central widget
-    moleGrid = new QGridLayout();   // Grid layout for mole buttons
 
     scoreLabel = new QLabel("Score: 0", this);  // Initialize the score label
     startButton = new QPushButton("Start Game", this);  // Button to start the game
     endButton = new QPushButton("End Game", this);  // Button to end the game
 
-    // Setup mole buttons with the respective colors
-    const QStringList colors = {"red", "blue", "green", "yellow"};
-    int i = 0;
-    for (const QString &color : colors) {
-        QPushButton *button = new QPushButton(this);
-        button->setStyleSheet(QString("background-color: %1").arg(color));
-        // button->setStyleSheet("QPushButton { border: none; }"); // Remove borders
-        button->setFixedSize(100, 100); // button sizes
-        moleButtons.append(button); // Add to list of mole buttons
-        moleGrid->addWidget(button, i / 2, i % 2);  // Add button to the grid layout
-        connect(button, &QPushButton::clicked, [this, i] { moleWhacked(i); });  // Connect button click to action
-        i++;
-
-        // Setup and start a thread for mole timers to manage visibility
-        moleTimerWorker = new MoleTimer();
-        moleTimerThread = new QThread(this);
-        moleTimerWorker->moveToThread(moleTimerThread);
-        connect(moleTimerThread, &QThread::finished, moleTimerWorker, &QObject::deleteLater);
-        connect(this, &MainWindow::startMoleTimer, moleTimerWorker, &MoleTimer::runTimer);
-        connect(moleTimerWorker, &MoleTimer::timeout, this, &MainWindow::hideMole);
-        moleTimerThread->start();
-    }
+    // Setup one mole cell per cabinet button, row by row like the kernel numbers them.
+    // Colors repeat every four cells, the 2x2 cabinet gets red, blue, green and yellow.
+    const whackamole_board board = hardware->board();
+    const int cellSize = qBound(48, 400 / int(qMax(board.rows, board.cols)), 100);    // Keep big boards on screen
+    moleGrid = new MoleGridWidget(int(board.rows), int(board.cols), cellSize, this);
+    connect(moleGrid, &MoleGridWidget::cellClicked, this, [this](int index) {
+        if (!kernelEngine)
+            moleWhacked(index, MoleScheduler::now()); });  // Connect cell click to action, the kernel only judges real buttons
 
     // Add all elements to the main layout and set it as the central widget
     mainLayout->addWidget(scoreLabel);
-    mainLayout->addLayout(moleGrid);
+    mainLayout->addWidget(moleGrid, 0, Qt::AlignHCenter);
     mainLayout->addWidget(startButton);
     mainLayout->addWidget(endButton);
     setCentralWidget(centralWidget);
 
-     // Initialize timers for game timing and updates
-    gameTimer = new QTimer(this);
-    moleTimer = new QTimer(this);
     connect(startButton, &QPushButton::clicked, this, &MainWindow::startGame);
     connect(endButton, &QPushButton::clicked, this, &MainWindow::endGame);
-    connect(gameTimer, &QTimer::timeout, this, &MainWindow::endGame);
-    connect(moleTimer, &QTimer::timeout, this, &MainWindow::updateGame);
-}
-
-// Polls the proc file for button press data from the kernel module
-void MainWindow::pollProcFile() {
-    QFile file("/proc/whackamole");
-    if (file.open(QIODevice::ReadOnly)) {
-        QTextStream stream(&file);  // Create a text stream for reading
-        QString line = stream.readLine();   // Read a single line from the file
-        qDebug() << "Read from /proc:" << line; // Debug output to log the line read from /proc
-        if (!line.isEmpty()) {
-            processButtonPress(line);  // Process the line if it's not empty
-        }
-        file.close();   // Close the file after reading
-    }
-}
-
-// Processes the button press information received from the /proc file
-void MainWindow::processButtonPress(const QString &buttonInfo) {
-    QRegExp regex("Button (\\d+) pressed"); // Regular expression to extract the button index
-    int btnIndex = -1;  // store the extracted button index
-
-    // Check if the button index is found in the string
-    if (regex.indexIn(buttonInfo) != -1) {
-        btnIndex = regex.cap(1).toInt();    // Convert the regex string to an int
-    }
-
-    qDebug() << "Regex grabbed:" << btnIndex;   // Debug output the extracted button index
-
-    moleWhacked(btnIndex);  // Whack the mole
-}
-
-/** Function for sending commands to the kernel module via the proc file
-*   @param command This is the command string to be send to the kernel module
-*/
-void sendCommandToKernelModule(const QString &command) {
-  QFile file("/proc/whackamole");
-  if(file.open(QIODevice::WriteOnly)) {
-    QTextStream stream(&file);    // Create a text stream for writing
-    stream << command;    // Write the command to the file
-    file.close();    // Close the file after writing
-  }
 }
 
 // Funtion to start the game
 void MainWindow::startGame()
 {
-    sendCommandToKernelModule("GAME_START");
     score = 0;    // Initialize the score to 0
     scoreLabel->setText("Score: 0");    // set the GUI text score to 0
+    dispatchLatency.reset(moleGrid->cellCount());    // Latency statistics cover one game
     startButton->setEnabled(false);    // Disable the start game button
-    gameTimer->start(20000); // 20 seconds game
-    moleTimer->start(1500); // Mole pops up every 1.5 second
+    const whackamole_board board = hardware->board();
+    sessionLog.begin(board.rows, board.cols, kernelEngine ? SESSIONLOG_KERNEL_ENGINE : 0);
+
+    const GameRules &rules = engine->rules();
+    if (kernelEngine) {    // The kernel times the round and the moles
+        whackamole_engine_config config = {};
+        config.duration_ms = rules.durationMs;
+        config.spawn_interval_ms = rules.spawnIntervalMs;
+        config.mole_window_ms = rules.moleWindowMs;
+        config.hit_points = rules.hitPoints;
+        config.miss_points = rules.missPoints;
+        config.timeout_points = rules.timeoutPoints;
+        config.max_moles = rules.maxMoles;
+        if (rules.spawnCurve != GameRules::SpawnCurve::Fixed)
+            qCWarning(lcGame) << "The kernel-run game only spawns at a fixed interval";
+        hardware->startEngine(config);
+        return;
+    }
+
+    engine->start(MoleScheduler::now());    // 20 seconds game, a mole pops up every 1.5 second
+    wakeEngine();
 }
 
 // Function to end the game
 void MainWindow::endGame()
 {
-    sendCommandToKernelModule("GAME_STOP");
-    gameTimer->stop();    // Stop the game timer
-    moleTimer->stop();    // Stop the mole timers
-    startButton->setEnabled(true);    // Reenable the start button
-    hideMole();    // Hide the moles
-    qDebug() << "Final Score:" << score;    // Show the final score in debug
-}
-
-// Function to update game state
-void MainWindow::updateGame()
-{
-    showMole();    // Show moles as they are generated
-}
-
-// Function to determine if a mole not whacked in the timing requirement
-void MainWindow::moleTimeout(int index) {    // Check if the timed out mole is the current mole
-    qDebug() << "Mole timeout called for index:" << index;
-    if (index == currentMole) {
-        score -= 1; // Deduct score for not hitting the mole in time
-        scoreLabel->setText(QString("Score: %1").arg(score));    // Update score
-        hideMole();    // Hide the mole since its timeout period has expired
+    if (kernelEngine) {
+        hardware->stopGame();    // The kernel reports the final score with a game over event
+        startButton->setEnabled(true);    // Reenable the start button
+        return;
     }
+    engine->stop(MoleScheduler::now());    // Reports gameOver()
 }
 
 /**
  * Processes the event when a mole is whacked by the player.
- * Function is triggered when a player clicks on a mole button. It checks if the mole whacked
- * is the currently active mole. If it is, the player's score is increased, the mole's image is updated,
- * and a timer is started to hide the mole shortly after. If the wrong mole is hit, the player's score is decreased.
+ * Function is triggered when a player clicks on a mole or presses a cabinet button, and hands
+ * the press to the game engine, which judges it against the moles that were up at its timestamp.
  *
  * @param moleIndex The index of the mole that was whacked.
+ * @param timestampNs CLOCK_MONOTONIC time of the press, the IRQ for cabinet buttons.
  */
-void MainWindow::moleWhacked(int moleIndex)
+void MainWindow::moleWhacked(int moleIndex, qint64 timestampNs)
 {
-    qDebug() << "Mole whacked at index:" << moleIndex;    // Debug output to log the whacked mole's index
-    if (moleIndex == currentMole)
-    {    // Check if the correct mole was whacked
-        score += 3;    // Increase score on correct hit
-        qDebug() << "Score increased to:" << score;    // Debug what the score was increased to
+    qCDebug(lcGame) << "Mole whacked at index:" << moleIndex;    // Debug output to log the whacked mole's index
+    engine->press(moleIndex, timestampNs);
+    wakeEngine();    // A hit schedules the bonk removal
+}
 
-        moleButtons[moleIndex]->setIcon(QIcon(":/images/bonk.png"));    // Mole's icon changed to the "whack" image
-        moleButtons[moleIndex]->setIconSize(moleButtons[moleIndex]->size());    // Adjust icon size to fit the button
+// Arms the scheduler with the engine's earliest deadline
+void MainWindow::wakeEngine()
+{
+    scheduler->cancel(engineWakeup);
+    engineWakeup = 0;
+    qint64 deadlineNs = engine->nextDeadline();
+    if (deadlineNs == DeadlineQueue::NO_DEADLINE)
+        return;    // Nothing pending, the round is over
+    engineWakeup = scheduler->at(deadlineNs, [this](qint64) {
+        engineWakeup = 0;
+        hardware->drainEvents();    // Presses that came in before the deadline are judged before it runs
+        engine->advanceTo(MoleScheduler::now());
+        wakeEngine(); });
+}
 
-        QTimer::singleShot(250, this, [this] { // Start a timer to hide the mole
-            hideMole();    // Hide the mole after a short delay
-            sendCommandToKernelModule("LED_OFF"); // Turn off LED
-        });
-    }
-    else
-    {
-        score -= 1;    // Deduct score if wrong mole was hit
-        qDebug() << "Score decreased to:" << score;
-    }
+// GUI-run game: shows a mole, the engine already lit its LED
+void MainWindow::moleShown(int index)
+{
+    moleGrid->setCell(index, MoleGridWidget::Mole);    // Show the mole in its colored hole
+}
+
+// GUI-run game: shows the bonk for a whacked mole
+void MainWindow::moleHit(int index)
+{
+    moleGrid->setCell(index, MoleGridWidget::Bonk);    // Mole's image changed to the "whack" image
+}
+
+// GUI-run game: removes a mole or its bonk
+void MainWindow::moleHidden(int index)
+{
+    moleGrid->setCell(index, MoleGridWidget::Empty);
+}
+
+// GUI-run game: shows the new score
+void MainWindow::scoreChanged(int newScore)
+{
+    score = newScore;
+    qCDebug(lcGame) << "Score changed to:" << score;
     scoreLabel->setText(QString("Score: %1").arg(score));    // Update the score
 }
 
-// Displays a new mole randomly on the game board, and sends command to the kernel to activate the corresponding LED
-void MainWindow::showMole() {
-    if (currentMole != -1)
-        hideMole();    // Hide the currently active mole if one is visible
+// GUI-run game: the round is over, get ready for the next one
+void MainWindow::gameOver(int finalScore)
+{
+    score = finalScore;
+    sessionLog.end();    // The engine already logged the game over
+    startButton->setEnabled(true);    // Reenable the start button
+    qCInfo(lcGame) << "Final Score:" << score;    // Show the final score in debug
+    qCInfo(lcGame).noquote() << "Dispatch latency:\n" + dispatchLatency.table();    // Compare with /proc/whackamole_stats
+}
+
+// GUI-run game: logs every press and decision of the engine
+void MainWindow::logged(const whackamole_event &event)
+{
+    sessionLog.append(event);
+}
 
-    int index = QRandomGenerator::global()->bounded(moleButtons.size());    // Randomly select a mole index
-    currentMole = index;    // Update the current mole index
+// Kernel-run game: shows the mole the kernel just lit up
+void MainWindow::engineMoleShown(int index)
+{
+    kernelMoles |= 1ull << index;
+    moleGrid->setCell(index, MoleGridWidget::Mole);    // Show the mole in its colored hole
+}
 
-    QString moleColor = moleButtons[index]->styleSheet().split(": ").last();    // Get the color of the mole from its style sheet
-    moleButtons[index]->setIcon(QIcon(QString(":/images/%1Mole.png").arg(moleColor)));    // Set the mole's icon based on its color
-    moleButtons[index]->setIconSize(moleButtons[index]->size());    // Ensure the icon size matches the button size
+// Kernel-run game: shows the bonk for a mole the kernel judged as hit
+void MainWindow::engineMoleHit(int index, int newScore)
+{
+    kernelMoles &= ~(1ull << index);    // The kernel already turned the LED off
+    moleGrid->setCell(index, MoleGridWidget::Bonk);    // Mole's image changed to the "whack" image
+    scheduler->after(engine->rules().bonkMs * NS_PER_MS, [this, index](qint64) {
+        if (!(kernelMoles & (1ull << index)))
+            moleGrid->setCell(index, MoleGridWidget::Empty);    // Remove the bonk unless a new mole took its place
+    });
+    engineScoreChanged(newScore);
+}
 
-    moleVisibilityTimers[index]->start(1500); // Start the timer for this mole
-    sendCommandToKernelModule(moleColor + "_ON");   // Send command to turn on corresponding LED
+// Kernel-run game: shows the score the kernel computed
+void MainWindow::engineScoreChanged(int newScore)
+{
+    score = newScore;
+    scoreLabel->setText(QString("Score: %1").arg(score));    // Update the score
 }
 
-void MainWindow::hideMole() {
-    if (currentMole != -1) {    // Check if there is a currently active mole
-        moleButtons[currentMole]->setIcon(QIcon());    // Remove the mole's icon
-        moleVisibilityTimers[currentMole]->stop(); // Stop the timer for this mole
-        sendCommandToKernelModule("LED_OFF");   // Send command to hide the mole
-        currentMole = -1;    // Reset the currentMole index to -1 indicating no active mole
-    }
+// Kernel-run game: the round is over, get ready for the next one
+void MainWindow::engineGameOver(int finalScore)
+{
+    engineScoreChanged(finalScore);
+    sessionLog.end();    // The game over record came through eventRead
+    moleGrid->clear();    // Remove the last moles and bonks
+    kernelMoles = 0;
+    startButton->setEnabled(true);    // Reenable the start button
+    qCInfo(lcGame) << "Final Score:" << score;    // Show the final score in debug
 }
 
 // Destructor for MainWindow, cleans up allocated resources
 MainWindow::~MainWindow()
 {
-    for (auto timer : moleVisibilityTimers) {    // Loop through all mole visibility timers
-        timer->stop();    // Stop the timer
-        delete timer;    // Delete the timer to free the memory
-    }
-    moleTimerThread->quit();    // Quit the mole timer
-    moleTimerThread->wait();    // Wait for mole timer thread to finish execution
+    scheduler->clear();    // No callback may run into a half-destroyed window
+    delete engine;
 }
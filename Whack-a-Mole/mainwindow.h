@@ -4,30 +4,17 @@
 #include <QMainWindow>
 #include <QPushButton>
 #include <QLabel>
-#include <QTimer>
-#include <QGridLayout>
-#include <QList>
-#include <QThread>
 #include <QObject>
 #include <QFile>
 
-/** 
-* custom QObject for managing mole visibility timers in a separate thread
-* Runs a timer with a specified interval and emits a timeout signal.
-*/
-class MoleTimer : public QObject {
-    Q_OBJECT
-public:
-    explicit MoleTimer(QObject *parent = nullptr) : QObject(parent) {}
-    void runTimer(int interval) {    // Run a sleep timer for specificed interval
-        QThread::sleep(interval);
-        emit timeout();
-    }
-signals:
-    void timeout();    // Signal emitted when timer completes
-};
+#include "gameengine.h"
+#include "hardwarechannel.h"
+#include "latencystats.h"
+#include "molegridwidget.h"
+#include "molescheduler.h"
+#include "sessionlog.h"
 
-class MainWindow : public QMainWindow
+class MainWindow : public QMainWindow, private GameListener
 {
     Q_OBJECT
 
@@ -35,35 +22,44 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);    // Constructor
     virtual ~MainWindow();    // Destructor
 
-signals:
-    void startMoleTimer(int interval);    // Signal to start a mole timer with a specified interval
+    void setKernelEngine(bool enabled);    // Let the kernel module run the game, the window only renders it, ignored without the module
+    void setLogDirectory(const QString &path);    // Where every game is logged, empty to disable logging
+    void setRules(const GameRules &rules);    // Rules of the next games, GUI- or kernel-run
 
 private slots:
     void startGame();    // Starts the game
     void endGame();    // Ends the game
-    void updateGame();    // Updates the game
-    void moleWhacked(int moleIndex);    // Called when a mole is whacked
-    void moleTimeout(int index);    // Determines if a mole is missed
-    void pollProcFile();    // Periodically poll the /proc file to check for changes
-    void processButtonPress(const QString &buttonInfo);    // Process and handle button presses
+    void moleWhacked(int moleIndex, qint64 timestampNs);    // Called when a mole is whacked
+    void engineMoleShown(int index);    // Kernel-run game: a mole popped up
+    void engineMoleHit(int index, int newScore);    // Kernel-run game: a mole was whacked
+    void engineScoreChanged(int newScore);    // Kernel-run game: a miss or timeout changed the score
+    void engineGameOver(int finalScore);    // Kernel-run game: the round ended
 
 private:
     QPushButton *startButton;    // Button to start the game
     QPushButton *endButton;    // Button to end the game
     QLabel *scoreLabel;    // button to track the score
-    QTimer *gameTimer;    // Main game timer
-    QTimer *moleTimer;    // Mole timer
     int score;    // Game score
-    int currentMole;    // Index of current active mole
-    QGridLayout *moleGrid;    // Layout for mole buttons
-    QList<QPushButton *> moleButtons;  // List to hold buttons for moles
-    QThread *moleTimerThread;    // Thread for running mole timers
-    MoleTimer *moleTimerWorker;    // Worker object to handle mole timers in a seperate thread
-    QVector<QTimer*> moleVisibilityTimers;  // Vector of timers each controlling the visibility of a mole
+    quint64 kernelMoles;    // Kernel-run game: bit i is set while mole i is up
+    bool kernelEngine;    // The kernel module runs the game
+    HardwareChannel *hardware;    // Connection to the kernel module
+    LatencyStats dispatchLatency;    // Time from the button IRQ to moleWhacked, per button
+    MoleGridWidget *moleGrid;    // The board of moles
+    GameEngine *engine;    // Rules of the GUI-run game
+    MoleScheduler *scheduler;    // Wakes the engine and removes bonks
+    MoleScheduler::Id engineWakeup;    // Pending wakeup of the engine, 0 if none
+    SessionLog sessionLog;    // Binary log of the game in progress
 
     void setupUi();    // Sets up the UI
-    void showMole();    // Shows a new mole 
-    void hideMole();    // Hides the mole
+    void wakeEngine();    // Schedule the engine's next deadline
+
+    // What the engine decided, see GameListener
+    void moleShown(int index) override;
+    void moleHit(int index) override;
+    void moleHidden(int index) override;
+    void scoreChanged(int newScore) override;
+    void gameOver(int finalScore) override;
+    void logged(const whackamole_event &event) override;
 };
 
 #endif // MAINWINDOW_H
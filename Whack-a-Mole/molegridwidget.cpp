@@ -0,0 +1,109 @@
+#include "molegridwidget.h"
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+
+// Hole colors, repeating every four cells like the cabinet's LEDs, and the matching mole sprites
+static const char *const COLORS[] = {"red", "blue", "green", "yellow"};
+static const int NUM_COLORS = sizeof(COLORS) / sizeof(COLORS[0]);
+
+/** Builds the board
+*   @param rows Rows of cells
+*   @param cols Columns of cells
+*   @param cellSize Width and height of a cell in pixels
+*   @param parent Parent widget
+*/
+MoleGridWidget::MoleGridWidget(int rows, int cols, int cellSize, QWidget *parent) : QWidget(parent),
+    rows(rows), cols(cols), cellSize(cellSize), cells(rows * cols, Empty)
+{
+    setFixedSize(cols * cellSize + (cols - 1) * SPACING, rows * cellSize + (rows - 1) * SPACING);
+    setAttribute(Qt::WA_OpaquePaintEvent);    // Cells cover their area, nothing to erase first
+    setAttribute(Qt::WA_NoSystemBackground);
+    buildSprites();
+}
+
+/** Changes what a cell shows
+*   @param index Index of the cell, row by row
+*   @param state What the cell shows from now on
+*/
+void MoleGridWidget::setCell(int index, CellState state)
+{
+    if (cells[index] == state)
+        return;    // Nothing to repaint
+    cells[index] = state;
+    update(cellRect(index));    // Only this cell is dirty
+}
+
+// Shows every cell empty
+void MoleGridWidget::clear()
+{
+    for (int i = 0; i < cells.size(); ++i)
+        setCell(i, Empty);
+}
+
+// Paints the cells that intersect the dirty region
+void MoleGridWidget::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    painter.fillRect(event->rect(), palette().window());    // Gaps between the cells
+    for (int i = 0; i < cells.size(); ++i) {
+        QRect rect = cellRect(i);
+        if (event->region().intersects(rect))
+            painter.drawPixmap(rect.topLeft(), sprites.value(spriteKey(colorOf(i), cells[i], cellSize)));
+    }
+}
+
+// Reports which cell was clicked
+void MoleGridWidget::mousePressEvent(QMouseEvent *event)
+{
+    for (int i = 0; i < cells.size(); ++i) {
+        if (cellRect(i).contains(event->pos())) {
+            emit cellClicked(i);
+            return;
+        }
+    }
+    QWidget::mousePressEvent(event);    // Click in a gap
+}
+
+/** Packs a cell description into a cache key
+*   @param color Index into COLORS
+*   @param state What the cell shows
+*   @param size Width and height of the cell in pixels
+*/
+quint64 MoleGridWidget::spriteKey(int color, CellState state, int size)
+{
+    return (quint64(color) << 40) | (quint64(state) << 32) | quint64(size);
+}
+
+// Decodes every sprite once and composes each color x state at the cell size
+void MoleGridWidget::buildSprites()
+{
+    const QPixmap bonk = QPixmap(":/images/bonk.png").scaled(cellSize, cellSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    for (int color = 0; color < NUM_COLORS; ++color) {
+        const QPixmap mole = QPixmap(QString(":/images/%1Mole.png").arg(COLORS[color]))
+                .scaled(cellSize, cellSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        const QPixmap *images[] = {nullptr, &mole, &bonk};    // Indexed by CellState
+        for (int state = Empty; state <= Bonk; ++state) {
+            QPixmap sprite(cellSize, cellSize);
+            sprite.fill(QColor(COLORS[color]));    // The colored hole
+            if (images[state]) {
+                QPainter painter(&sprite);
+                const QPixmap &image = *images[state];
+                painter.drawPixmap((cellSize - image.width()) / 2, (cellSize - image.height()) / 2, image);    // Centered like a button icon
+            }
+            sprites.insert(spriteKey(color, CellState(state), cellSize), sprite);
+        }
+    }
+}
+
+// Hole color of a cell, colors repeat every four cells
+int MoleGridWidget::colorOf(int index) const
+{
+    return index % NUM_COLORS;
+}
+
+// Where a cell is painted, cells are numbered row by row
+QRect MoleGridWidget::cellRect(int index) const
+{
+    return QRect((index % cols) * (cellSize + SPACING), (index / cols) * (cellSize + SPACING), cellSize, cellSize);
+}
@@ -0,0 +1,55 @@
+#ifndef MOLEGRIDWIDGET_H
+#define MOLEGRIDWIDGET_H
+
+#include <QWidget>
+#include <QHash>
+#include <QPixmap>
+#include <QVector>
+
+/**
+* The board of moles, painted as one widget.
+* Every cell image (hole color x state) is decoded, scaled and composed once into a pixmap
+* cache, so showing or whacking a mole is a cache lookup, and only the cells that changed
+* are repainted.
+*/
+class MoleGridWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum CellState {
+        Empty,    // Just the colored hole
+        Mole,    // A mole is up
+        Bonk,    // The mole was just whacked
+    };
+
+    explicit MoleGridWidget(int rows, int cols, int cellSize, QWidget *parent = nullptr);    // Builds the board and its sprite cache
+
+    int cellCount() const { return cells.size(); }    // # of cells on the board
+    CellState cell(int index) const { return cells[index]; }    // What a cell shows
+    void setCell(int index, CellState state);    // Change what a cell shows, repaints just that cell
+    void clear();    // Show every cell empty
+
+signals:
+    void cellClicked(int index);    // A cell was clicked
+
+protected:
+    void paintEvent(QPaintEvent *event) override;    // Paints the dirty cells
+    void mousePressEvent(QMouseEvent *event) override;    // Turns a click into cellClicked
+
+private:
+    static const int SPACING = 6;    // Gap between two cells in pixels
+
+    int rows;    // Rows of cells
+    int cols;    // Columns of cells
+    int cellSize;    // Width and height of a cell in pixels
+    QVector<CellState> cells;    // What each cell shows
+    QHash<quint64, QPixmap> sprites;    // Pre-rendered cells keyed by spriteKey()
+
+    static quint64 spriteKey(int color, CellState state, int size);    // Cache key of a pre-rendered cell
+    void buildSprites();    // Render every color x state at cellSize
+    int colorOf(int index) const;    // Hole color of a cell
+    QRect cellRect(int index) const;    // Where a cell is painted
+};
+
+#endif // MOLEGRIDWIDGET_H
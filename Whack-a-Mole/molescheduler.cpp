@@ -0,0 +1,95 @@
+#include "molescheduler.h"
+#include "logging.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <time.h>
+#include <cerrno>
+#include <cstring>
+
+// Creates the timerfd the whole schedule runs on
+MoleScheduler::MoleScheduler(QObject *parent) : QObject(parent), timerFd(-1), notifier(nullptr),
+    armedNs(DeadlineQueue::NO_DEADLINE)
+{
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerFd >= 0) {
+        notifier = new QSocketNotifier(timerFd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &MoleScheduler::fire);
+    } else {
+        qCWarning(lcScheduler) << "Unable to create the mole timer:" << strerror(errno);
+    }
+}
+
+// Reads CLOCK_MONOTONIC in nanoseconds
+qint64 MoleScheduler::now()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+/** Schedules a callback
+*   @param deadlineNs Absolute CLOCK_MONOTONIC time to run it at
+*   @param callback What to run, it receives deadlineNs so periodic work can chain from it
+*   @return Handle for cancel()
+*/
+MoleScheduler::Id MoleScheduler::at(qint64 deadlineNs, Callback callback)
+{
+    Id id = queue.schedule(deadlineNs, std::move(callback));
+    if (deadlineNs < armedNs)
+        rearm();    // New earliest deadline
+    return id;
+}
+
+/** Cancels a pending callback. The timerfd stays armed, an early wakeup just finds nothing due.
+*   @param id Handle returned by at() or after(), 0 is ignored
+*/
+void MoleScheduler::cancel(Id id)
+{
+    queue.cancel(id);
+}
+
+// Cancels every pending callback
+void MoleScheduler::clear()
+{
+    queue.clear();
+    rearm();
+}
+
+// Runs every callback that is due, then waits for the next deadline
+void MoleScheduler::fire()
+{
+    quint64 expirations;
+    if (::read(timerFd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        qCWarning(lcScheduler) << "Reading the mole timer failed:" << strerror(errno);
+
+    armedNs = DeadlineQueue::NO_DEADLINE;    // Callbacks that schedule must not skip rearming
+    queue.runDue(now());
+    rearm();
+}
+
+// Arms the timerfd with the earliest pending deadline, or disarms it
+void MoleScheduler::rearm()
+{
+    if (timerFd < 0)
+        return;
+
+    armedNs = queue.nextDeadline();
+    itimerspec spec = {};    // All zero disarms the timer
+    if (armedNs != DeadlineQueue::NO_DEADLINE) {
+        qint64 deadline = qMax<qint64>(armedNs, 1);    // A zero it_value would disarm instead of firing at once
+        spec.it_value.tv_sec = deadline / 1000000000;
+        spec.it_value.tv_nsec = deadline % 1000000000;
+    }
+    if (timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0)
+        qCWarning(lcScheduler) << "Arming the mole timer failed:" << strerror(errno);
+}
+
+// Closes the timerfd
+MoleScheduler::~MoleScheduler()
+{
+    if (timerFd >= 0) {
+        delete notifier;    // The notifier must go before its descriptor
+        ::close(timerFd);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef MOLESCHEDULER_H
+#define MOLESCHEDULER_H
+
+#include <QObject>
+#include <QSocketNotifier>
+
+#include "deadlinequeue.h"
+
+/**
+* Runs DeadlineQueue callbacks on the GUI thread when their deadline is reached.
+* A single timerfd armed with the earliest absolute CLOCK_MONOTONIC deadline wakes the
+* event loop, so precision is sub-millisecond and periodic work scheduled from its own
+* deadline does not drift, no matter how many moles are pending.
+*/
+class MoleScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Id = DeadlineQueue::Id;
+    using Callback = DeadlineQueue::Callback;
+
+    explicit MoleScheduler(QObject *parent = nullptr);    // Creates the timerfd
+    virtual ~MoleScheduler();    // Closes the timerfd
+
+    static qint64 now();    // CLOCK_MONOTONIC in nanoseconds, the clock of every deadline
+
+    Id at(qint64 deadlineNs, Callback callback);    // Run a callback at an absolute deadline
+    Id after(qint64 delayNs, Callback callback) { return at(now() + delayNs, std::move(callback)); }    // Run a callback after a delay
+    void cancel(Id id);    // Forget a pending callback
+    void clear();    // Forget every pending callback
+
+private slots:
+    void fire();    // The timerfd expired, run what is due
+
+private:
+    DeadlineQueue queue;    // Every pending deadline
+    int timerFd;    // Armed with the earliest deadline, -1 if it could not be created
+    QSocketNotifier *notifier;    // Signals when timerFd expires
+    qint64 armedNs;    // Deadline timerFd is armed with, DeadlineQueue::NO_DEADLINE if disarmed
+
+    void rearm();    // Arm timerFd with the earliest pending deadline
+};
+
+#endif // MOLESCHEDULER_H
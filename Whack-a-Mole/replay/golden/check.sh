@@ -0,0 +1,31 @@
+#!/bin/sh
+# Score regression check: replays the checked-in traces and compares every digest with the
+# one recorded when the rules last changed on purpose. Traces are files, not --presses, so
+# the check does not depend on the standard library's random distributions.
+#   Whack-a-Mole/replay/golden/check.sh path/to/whackamole-replay
+# A rule change that alters scoring on purpose updates the digests here in the same commit.
+set -u
+
+REPLAY=${1:?usage: $0 path/to/whackamole-replay}
+HERE=$(cd "$(dirname "$0")" && pwd)
+FAILED=0
+
+# check <digest> <trace> [replay options]
+check() {
+    digest=$1 trace=$2
+    shift 2
+    if "$REPLAY" --expect "$digest" "$@" "$HERE/$trace" > /dev/null; then
+        echo "ok   $trace $*"
+    else
+        echo "FAIL $trace $*"
+        FAILED=1
+    fi
+}
+
+check 562eeb68ad4b32f3 sparse.trace
+check 26c1d9451316f59d dense.trace
+check 82beabc085c484b6 bonk-respawn.trace
+check 695618e210d8b65e dense.trace --moles 3 --spawn-ms 500
+check 9ad651496053cbe1 dense.trace --spawn-curve poisson
+check 680d5f4af667b146 dense.trace --spawn-curve accelerating --moles 2
+exit $FAILED
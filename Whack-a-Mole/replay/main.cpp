@@ -0,0 +1,114 @@
+#include "replaydriver.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+        "usage: %s [options] [trace]\n"
+        "  trace              presses to replay, \"<time_ns> <button>\" per line,\n"
+        "                     a synthetic trace is generated when omitted\n"
+        "  --buttons N        moles on the board (default 4)\n"
+        "  --presses N        presses in the synthetic trace (default 1000000)\n"
+        "  --gap-us N         mean time between synthetic presses (default 20)\n"
+        "  --moles N          moles up at the same time (default 1)\n"
+        "  --spawn-ms N       time between two moles (default 1500)\n"
+        "  --spawn-curve C    fixed, poisson or accelerating (default fixed)\n"
+        "  --seed N           seed of the mole picker and the synthetic trace (default 5489)\n"
+        "  --rounds N         replay the trace N times and report the throughput (default 1)\n"
+        "  --save FILE        write the trace that was replayed to FILE\n"
+        "  --expect DIGEST    exit with status 1 unless the digest is DIGEST\n", argv0);
+}
+
+/**
+ * Replays a press trace through the game rules on a virtual clock and prints the score and
+ * the digest of every engine decision. Two builds score the trace identically exactly when
+ * they print the same digest.
+ */
+int main(int argc, char *argv[])
+{
+    int buttons = 4;
+    std::size_t presses = 1000000;
+    long long gapUs = 20;
+    unsigned long seed = std::mt19937::default_seed;
+    long rounds = 1;
+    const char *tracePath = nullptr;
+    const char *savePath = nullptr;
+    const char *expected = nullptr;
+    GameRules rules;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--buttons") && hasValue)
+            buttons = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--presses") && hasValue)
+            presses = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--gap-us") && hasValue)
+            gapUs = std::atoll(argv[++i]);
+        else if (!std::strcmp(argv[i], "--moles") && hasValue)
+            rules.maxMoles = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--spawn-ms") && hasValue)
+            rules.spawnIntervalMs = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--spawn-curve") && hasValue && parseSpawnCurve(argv[i + 1], &rules.spawnCurve))
+            ++i;
+        else if (!std::strcmp(argv[i], "--seed") && hasValue)
+            seed = std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--rounds") && hasValue)
+            rounds = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--save") && hasValue)
+            savePath = argv[++i];
+        else if (!std::strcmp(argv[i], "--expect") && hasValue)
+            expected = argv[++i];
+        else if (argv[i][0] != '-' && !tracePath)
+            tracePath = argv[i];
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (buttons < 1 || buttons > 64 || gapUs < 1 || rounds < 1 || rules.maxMoles < 1 || rules.spawnIntervalMs < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<ReplayDriver::Press> trace;
+    if (tracePath) {
+        std::ifstream in(tracePath);
+        if (!in) {
+            std::perror(tracePath);
+            return 1;
+        }
+        std::string error;
+        if (!ReplayDriver::load(in, buttons, &trace, &error)) {
+            std::fprintf(stderr, "%s: %s\n", tracePath, error.c_str());
+            return 1;
+        }
+    } else {
+        trace = ReplayDriver::synthetic(presses, buttons, gapUs * 1000, std::uint32_t(seed));
+    }
+    if (savePath) {
+        std::ofstream out(savePath);
+        ReplayDriver::save(out, trace);
+    }
+
+    ReplayDriver driver(buttons, rules, std::uint32_t(seed));
+    ReplayDriver::Result result;
+    auto begin = std::chrono::steady_clock::now();
+    for (long round = 0; round < rounds; ++round)
+        result = driver.run(trace);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::printf("presses %zu moles %zu hits %zu score %d digest %016llx\n",
+                result.presses, result.moles, result.hits, result.score, (unsigned long long)result.digest);
+    std::printf("%ld rounds in %.3f s, %.0f presses/s\n", rounds, seconds, seconds > 0 ? rounds * result.presses / seconds : 0.0);
+    if (expected && std::strtoull(expected, nullptr, 16) != result.digest) {
+        std::fprintf(stderr, "digest %016llx, expected %s\n", (unsigned long long)result.digest, expected);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,22 @@
+# Headless replay of press traces through the game rules, for benchmarks and score regressions
+
+QT       -= core gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+TARGET = whackamole-replay
+
+include(../engine.pri)
+
+SOURCES += \
+    main.cpp \
+    ../replaydriver.cpp
+
+HEADERS += \
+    ../replaydriver.h
+
+# make check replays the golden traces and fails if scoring changed
+check.commands = $$PWD/golden/check.sh $$OUT_PWD/$$TARGET
+check.depends = $(TARGET)
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,136 @@
+#include "replaydriver.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+
+static const std::uint64_t FNV_OFFSET = 14695981039346656037ull;
+static const std::uint64_t FNV_PRIME = 1099511628211ull;
+
+/** Reads a trace, one "<time_ns> <button>" press per line. Empty lines and lines starting
+*   with # are skipped, presses are sorted by time.
+*   @param in Stream to read
+*   @param buttons # of buttons on the board, every press must be on one of them
+*   @param trace Receives the presses
+*   @param error Receives the line that could not be read
+*   @return False if a line is not a press or its button is not on the board
+*/
+bool ReplayDriver::load(std::istream &in, int buttons, std::vector<Press> *trace, std::string *error)
+{
+    std::string line;
+    trace->clear();
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        long long timeNs;
+        int button;
+        char extra;
+        if (std::sscanf(line.c_str(), "%lld %d %c", &timeNs, &button, &extra) != 2) {
+            *error = "line " + std::to_string(lineNo) + ": expected \"<time_ns> <button>\"";
+            return false;
+        }
+        if (button < 0 || button >= buttons) {
+            *error = "line " + std::to_string(lineNo) + ": button " + std::to_string(button) + " is not on a board of "
+                     + std::to_string(buttons);
+            return false;
+        }
+        trace->push_back(Press{timeNs, button});
+    }
+    std::stable_sort(trace->begin(), trace->end(), [](const Press &a, const Press &b) { return a.timeNs < b.timeNs; });
+    return true;
+}
+
+/** Writes a trace load() can read back
+*   @param out Stream to write
+*   @param trace The presses
+*/
+void ReplayDriver::save(std::ostream &out, const std::vector<Press> &trace)
+{
+    out << "# time_ns button\n";
+    for (const Press &press : trace)
+        out << press.timeNs << ' ' << press.button << '\n';
+}
+
+/** Generates random presses with exponentially distributed gaps, like impatient players
+*   @param presses # of presses
+*   @param buttons # of buttons to pick from
+*   @param meanGapNs Average time between two presses
+*   @param seed Equal seeds give equal traces on the same standard library
+*   @return The presses, sorted by time
+*/
+std::vector<ReplayDriver::Press> ReplayDriver::synthetic(std::size_t presses, int buttons, std::int64_t meanGapNs, std::uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::exponential_distribution<double> gap(1.0 / double(meanGapNs));
+    std::vector<Press> trace;
+    trace.reserve(presses);
+    std::int64_t timeNs = 0;
+    for (std::size_t i = 0; i < presses; ++i) {
+        timeNs += std::int64_t(gap(random));
+        trace.push_back(Press{timeNs, int(random() % std::uint32_t(buttons))});
+    }
+    return trace;
+}
+
+/** Creates a driver for one board
+*   @param buttons # of moles on the board
+*   @param rules Rules of every round
+*   @param seed Mole picker seed, every run() starts from it again
+*/
+ReplayDriver::ReplayDriver(int buttons, const GameRules &rules, std::uint32_t seed) : rules(rules), buttons(buttons), seed(seed)
+{
+}
+
+/** Replays a trace as one round starting at virtual time 0. Presses after the end of the
+*   round are ignored by the engine, the round always runs to its end.
+*   @param trace Presses sorted by time
+*   @return Score, counters and digest of the round
+*/
+ReplayDriver::Result ReplayDriver::run(const std::vector<Press> &trace)
+{
+    result = Result();
+    result.digest = FNV_OFFSET;
+    board = FakeDevice();
+    GameEngine engine(board, *this, buttons, rules, seed);
+    engine.start(0);
+    for (const Press &press : trace) {
+        playUntil(engine, press.timeNs);
+        engine.press(press.button, press.timeNs);
+        ++result.presses;
+    }
+    playUntil(engine, DeadlineQueue::NO_DEADLINE - 1);    // Play out the rest of the round
+    result.score = engine.score();
+    return result;
+}
+
+/** Runs every deadline up to a time, each at its own instant. The virtual clock is never
+*   late, so the engine never skips a spawn to catch up.
+*   @param engine The engine of the round
+*   @param timeNs Virtual time to advance to
+*/
+void ReplayDriver::playUntil(GameEngine &engine, std::int64_t timeNs)
+{
+    std::int64_t deadlineNs;
+    while ((deadlineNs = engine.nextDeadline()) <= timeNs)
+        engine.advanceTo(deadlineNs);
+}
+
+/** Folds one engine callback into the digest
+*   @param kind Which callback
+*   @param value Its argument
+*/
+void ReplayDriver::fold(std::uint64_t kind, std::int64_t value)
+{
+    std::uint64_t word = (kind << 56) ^ std::uint64_t(value);
+    for (int i = 0; i < 8; ++i) {
+        result.digest ^= (word >> (8 * i)) & 0xff;
+        result.digest *= FNV_PRIME;
+    }
+}
+
+void ReplayDriver::moleShown(int index) { ++result.moles; fold(1, index); }
+void ReplayDriver::moleHit(int index) { ++result.hits; fold(2, index); }
+void ReplayDriver::moleHidden(int index) { fold(3, index); }
+void ReplayDriver::scoreChanged(int score) { fold(4, score); }
+void ReplayDriver::gameOver(int score) { fold(5, score); }
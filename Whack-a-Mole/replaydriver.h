@@ -0,0 +1,62 @@
+#ifndef REPLAYDRIVER_H
+#define REPLAYDRIVER_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "fakedevice.h"
+#include "gameengine.h"
+
+/**
+* Plays press traces through a GameEngine on a virtual clock, without a window, a timer
+* or a kernel module. Every callback of the engine is folded into a digest, so two
+* builds score a trace identically exactly when their digests match.
+*/
+class ReplayDriver : public GameListener
+{
+public:
+    // One press of a trace, relative to the start of the round
+    struct Press {
+        std::int64_t timeNs;    // When the button was pressed
+        int button;    // Which button
+    };
+
+    // Outcome of one replayed round
+    struct Result {
+        int score = 0;    // Final score
+        std::size_t presses = 0;    // Presses fed to the engine
+        std::size_t moles = 0;    // Moles shown
+        std::size_t hits = 0;    // Moles whacked
+        std::uint64_t digest = 0;    // FNV-1a over every engine callback in order
+    };
+
+    static bool load(std::istream &in, int buttons, std::vector<Press> *trace, std::string *error);    // Read a "<time_ns> <button>" per line trace
+    static void save(std::ostream &out, const std::vector<Press> &trace);    // Write a trace load() can read
+    static std::vector<Press> synthetic(std::size_t presses, int buttons, std::int64_t meanGapNs, std::uint32_t seed);    // Random presses
+
+    explicit ReplayDriver(int buttons, const GameRules &rules = GameRules(), std::uint32_t seed = std::mt19937::default_seed);
+
+    Result run(const std::vector<Press> &trace);    // Replay a trace as one round
+    const FakeDevice &device() const { return board; }    // Board the replay drove
+
+private:
+    FakeDevice board;    // Stands in for the cabinet
+    GameRules rules;    // Rules of every round
+    int buttons;    // # of moles on the board
+    std::uint32_t seed;    // Mole picker seed, the same for every round
+    Result result;    // Round being replayed
+
+    static void playUntil(GameEngine &engine, std::int64_t timeNs);    // Run every deadline up to timeNs on time
+    void fold(std::uint64_t kind, std::int64_t value);    // Add one callback to the digest
+
+    void moleShown(int index) override;
+    void moleHit(int index) override;
+    void moleHidden(int index) override;
+    void scoreChanged(int score) override;
+    void gameOver(int score) override;
+};
+
+#endif // REPLAYDRIVER_H
@@ -0,0 +1,127 @@
+#include "sessionlog.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// Reads a clock in nanoseconds
+static std::int64_t clockNs(clockid_t clock)
+{
+    timespec now;
+    clock_gettime(clock, &now);
+    return std::int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+// Writes a whole buffer, retrying short writes
+static bool writeAll(int fd, const void *data, std::size_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+    while (size) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        bytes += written;
+        size -= std::size_t(written);
+    }
+    return true;
+}
+
+/** Starts a new session file named after the current time, ending the open one first
+*   @param rows Rows of the board
+*   @param cols Columns of the board
+*   @param flags SessionLogFlags
+*   @return True if the session is being logged
+*/
+bool SessionLog::begin(std::uint32_t rows, std::uint32_t cols, std::uint32_t flags)
+{
+    end();
+    if (directory.empty())
+        return false;    // Logging disabled
+
+    SessionLogHeader header = {};
+    std::memcpy(header.magic, SESSIONLOG_MAGIC, sizeof(header.magic));
+    header.version = SESSIONLOG_VERSION;
+    header.headerSize = sizeof(SessionLogHeader);
+    header.recordSize = sizeof(SessionLogRecord);
+    header.flags = flags;
+    header.rows = rows;
+    header.cols = cols;
+    header.startRealtimeNs = clockNs(CLOCK_REALTIME);
+    header.startMonotonicNs = clockNs(CLOCK_MONOTONIC);
+
+    // session-<date>-<time>-<ms>-<pid>[-<n>], so names sort by start time and never collide
+    char name[96];
+    time_t seconds = time_t(header.startRealtimeNs / 1000000000);
+    tm local;
+    localtime_r(&seconds, &local);
+    std::size_t len = strftime(name, sizeof(name), "session-%Y%m%d-%H%M%S", &local);
+    std::snprintf(name + len, sizeof(name) - len, "-%03d-%d", int(header.startRealtimeNs / 1000000 % 1000), int(getpid()));
+
+    for (int attempt = 0; fd < 0 && attempt < 100; ++attempt) {
+        filePath = directory + "/" + name + (attempt ? "-" + std::to_string(attempt) : std::string()) + SESSIONLOG_SUFFIX;
+        fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0 && errno != EEXIST)
+            break;
+    }
+    if (fd < 0 || !writeAll(fd, &header, sizeof(header))) {
+        std::fprintf(stderr, "Unable to log the session to %s: %s\n", filePath.c_str(), std::strerror(errno));
+        end();
+        return false;
+    }
+    lastScore = 0;
+    pending.reserve(BATCH);
+    return true;
+}
+
+/** Logs one record. Records are written in batches, and when the game ends.
+*   @param event The event as the kernel or the game engine reported it
+*/
+void SessionLog::append(const whackamole_event &event)
+{
+    if (fd < 0)
+        return;
+
+    SessionLogRecord record;
+    record.timestampNs = std::int64_t(event.timestamp_ns);
+    record.type = event.type;
+    record.button = event.button;
+    record.scoreDelta = 0;
+    record.score = event.score;
+    record.latencyUs = event.latency_us;
+    if (event.type == WHACKAMOLE_EVENT_HIT || event.type == WHACKAMOLE_EVENT_MISS || event.type == WHACKAMOLE_EVENT_TIMEOUT) {
+        record.scoreDelta = event.score - lastScore;    // Only these change the score, other events may not carry it
+        lastScore = event.score;
+    }
+    pending.push_back(record);
+
+    if (pending.size() >= BATCH || event.type == WHACKAMOLE_EVENT_GAME_OVER)
+        flush();
+}
+
+// Writes the pending records to the end of the file
+void SessionLog::flush()
+{
+    if (fd >= 0 && !pending.empty() && !writeAll(fd, pending.data(), pending.size() * sizeof(SessionLogRecord)))
+        std::fprintf(stderr, "Writing %s failed: %s\n", filePath.c_str(), std::strerror(errno));
+    pending.clear();
+}
+
+// Flushes and closes the open session
+void SessionLog::end()
+{
+    flush();
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    filePath.clear();
+}
+
+SessionLog::~SessionLog()
+{
+    end();
+}
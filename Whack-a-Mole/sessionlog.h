@@ -0,0 +1,42 @@
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <string>
+#include <vector>
+
+#include "sessionlogformat.h"
+
+/**
+* Streams the records of one game at a time into a session log, see sessionlogformat.h.
+* Records are batched in memory and appended with one write() per batch, and whenever the
+* game ends, so logging never costs a system call per event.
+*/
+class SessionLog
+{
+public:
+    SessionLog() {}
+    ~SessionLog();    // Flushes and closes the open session
+
+    SessionLog(const SessionLog &) = delete;
+    SessionLog &operator=(const SessionLog &) = delete;
+
+    void setDirectory(const std::string &path) { directory = path; }    // Where new sessions are written, empty disables logging
+    const std::string &path() const { return filePath; }    // File of the open session, empty if none
+
+    bool begin(std::uint32_t rows, std::uint32_t cols, std::uint32_t flags);    // Start a new session file
+    void append(const whackamole_event &event);    // Log one record of the open session
+    void end();    // Flush and close the open session
+
+private:
+    static const std::size_t BATCH = 128;    // Records buffered between two writes
+
+    std::string directory;    // Where new sessions are written
+    std::string filePath;    // File of the open session
+    int fd = -1;    // Descriptor of the open session, -1 if none
+    std::int32_t lastScore = 0;    // Score after the last hit, miss or timeout
+    std::vector<SessionLogRecord> pending;    // Records not written yet
+
+    void flush();    // Write the pending records
+};
+
+#endif // SESSIONLOG_H
@@ -0,0 +1,49 @@
+#ifndef SESSIONLOGFORMAT_H
+#define SESSIONLOGFORMAT_H
+
+#include <cstdint>
+
+#include "whackamole_uapi.h"
+
+/**
+* On-disk layout of a session log, one file per game.
+* A file is a SessionLogHeader followed by SessionLogRecords up to the end of the file. Both
+* have a fixed size and natural alignment, so a mapped file is read in place as an array,
+* without parsing. Files are only ever appended to. A record cut short by a crash is ignored,
+* so the record count is (file size - headerSize) / recordSize. Fields are in the byte order
+* of the machine that wrote them, which is little endian on every cabinet.
+*/
+
+#define SESSIONLOG_MAGIC "WAMLOG\r\n"    // Also catches text-mode line ending mangling
+#define SESSIONLOG_VERSION 1
+#define SESSIONLOG_SUFFIX ".wamlog"
+
+enum SessionLogFlags : std::uint32_t {
+    SESSIONLOG_KERNEL_ENGINE = 1u << 0,    // The kernel module ran the game
+};
+
+struct SessionLogHeader {
+    char magic[8];    // SESSIONLOG_MAGIC without its terminating zero
+    std::uint32_t version;    // SESSIONLOG_VERSION
+    std::uint32_t headerSize;    // sizeof(SessionLogHeader), records start here
+    std::uint32_t recordSize;    // sizeof(SessionLogRecord)
+    std::uint32_t flags;    // SessionLogFlags
+    std::uint32_t rows;    // Layout of the board
+    std::uint32_t cols;
+    std::int64_t startRealtimeNs;    // CLOCK_REALTIME when the game started, for dating sessions
+    std::int64_t startMonotonicNs;    // CLOCK_MONOTONIC when the game started, record timestamps are on this clock
+};
+
+struct SessionLogRecord {
+    std::int64_t timestampNs;    // CLOCK_MONOTONIC time of the event
+    std::uint16_t type;    // enum whackamole_event_type
+    std::uint16_t button;    // Button or mole the event refers to
+    std::int32_t scoreDelta;    // Change of the score caused by the event
+    std::int32_t score;    // Score after the event
+    std::uint32_t latencyUs;    // Reaction time of presses on the mole that is up, 0 otherwise
+};
+
+static_assert(sizeof(SessionLogHeader) == 48, "SessionLogHeader layout changed, bump SESSIONLOG_VERSION");
+static_assert(sizeof(SessionLogRecord) == 24, "SessionLogRecord layout changed, bump SESSIONLOG_VERSION");
+
+#endif // SESSIONLOGFORMAT_H
@@ -0,0 +1,66 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+/**
+* Bounded lock-free queue between exactly one producer thread and one consumer thread.
+* Each side only writes its own index, so neither ever blocks or takes a lock, and the
+* two indices live on separate cache lines so the threads don't fight over one. The lines
+* are kept apart by padding rather than alignas, so the queue and whatever holds it need no
+* over-aligned allocation, which plain new only honours from C++17 on.
+*/
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity must be a power of 2");
+
+public:
+    /** Producer: appends a value
+    *   @param value What to append
+    *   @return False if the queue is full, the value was not appended
+    */
+    bool push(const T &value)
+    {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        slots[t & (Capacity - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);    // Publish the slot
+        return true;
+    }
+
+    /** Consumer: takes the oldest value
+    *   @param value Receives the value
+    *   @return False if the queue is empty
+    */
+    bool pop(T &value)
+    {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        value = slots[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);    // Hand the slot back
+        return true;
+    }
+
+    // Producer: # of values that can be pushed right now
+    std::size_t freeSpace() const
+    {
+        return Capacity - (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+    }
+
+private:
+    static const std::size_t CACHE_LINE = 64;
+    typedef std::atomic<std::size_t> Index;
+
+    char frontPad[CACHE_LINE];    // Keeps head off the line of whatever comes before the queue
+    Index head{0};    // Next slot to pop, written by the consumer only
+    char headPad[CACHE_LINE - sizeof(Index)];    // A whole line from head to tail
+    Index tail{0};    // Next slot to push, written by the producer only
+    char tailPad[CACHE_LINE - sizeof(Index)];    // And from tail to the slots
+    T slots[Capacity];
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,83 @@
+#!/bin/sh
+# Hardware-in-the-loop benchmark of final_project_proc.c without a board.
+#
+# Builds the module against the running kernel, creates a gpio-sim chip with one line per
+# button and one per LED, loads the module with that pin map and runs irqbench on it.
+# Needs root, configfs and CONFIG_GPIO_SIM. Arguments are passed to irqbench, e.g.
+#   sudo bench/hil-bench.sh --presses 100000 --rate 20000 --open-loop
+# Environment: ROWS, COLS (board, default 2x2), KDIR (kernel build tree).
+# gpio-sim lines may sleep like those of I2C expanders. A run whose kernel log shows the module
+# sleeping in atomic context, or any other warning, fails instead of reporting its numbers.
+set -eu
+
+ROWS=${ROWS:-2}
+COLS=${COLS:-2}
+KDIR=${KDIR:-/lib/modules/$(uname -r)/build}
+BUTTONS=$((ROWS * COLS))
+SIM=/sys/kernel/config/gpio-sim/whackamole-bench
+HERE=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+
+cleanup() {
+    rmmod final_project_proc 2>/dev/null || true
+    if [ -d "$SIM" ]; then
+        echo 0 > "$SIM/live" 2>/dev/null || true
+        rmdir "$SIM/bank0" "$SIM" 2>/dev/null || true
+    fi
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+# Build out of tree, so the checkout stays clean
+cp "$HERE/../Kbuild" "$HERE/../final_project_proc.c" "$HERE/../whackamole_uapi.h" "$HERE/../whackamole_hist.h" \
+   "$HERE/../whackamole_trace.h" "$WORK/"
+make -s -C "$KDIR" M="$WORK" modules
+${CC:-cc} -std=gnu11 -O2 -Wall -pthread -I"$HERE/.." "$HERE/irqbench.c" -o "$WORK/irqbench"
+
+# Lines 0..BUTTONS-1 are buttons, BUTTONS..2*BUTTONS-1 are LEDs
+modprobe gpio-sim
+mountpoint -q /sys/kernel/config || mount -t configfs none /sys/kernel/config
+mkdir "$SIM" "$SIM/bank0"
+echo $((2 * BUTTONS)) > "$SIM/bank0/num_lines"
+echo 1 > "$SIM/live"
+DEV=$(cat "$SIM/dev_name")
+CHIP=$(cat "$SIM/bank0/chip_name")
+CHIP_DIR=/sys/devices/platform/$DEV/$CHIP
+
+# The module still takes legacy GPIO numbers, find where the chip starts
+BASE=
+for c in /sys/class/gpio/gpiochip*; do
+    if [ "$(basename "$(readlink -f "$c/device")")" = "$CHIP" ]; then
+        BASE=$(cat "$c/base")
+    fi
+done
+if [ -z "$BASE" ] && [ -r /sys/kernel/debug/gpio ]; then
+    BASE=$(sed -n "s/^$CHIP: GPIOs \([0-9]*\)-.*/\1/p" /sys/kernel/debug/gpio)
+fi
+[ -n "$BASE" ] || { echo "cannot find the GPIO base of $CHIP" >&2; exit 1; }
+
+# Buttons idle high like on the cabinet, before the module requests their IRQs
+BTNS= LEDS=
+i=0
+while [ $i -lt $BUTTONS ]; do
+    echo pull-up > "$CHIP_DIR/sim_gpio$i/pull"
+    BTNS=${BTNS:+$BTNS,}$((BASE + i))
+    LEDS=${LEDS:+$LEDS,}$((BASE + BUTTONS + i))
+    i=$((i + 1))
+done
+
+MARK="whackamole-bench: start $$"
+echo "$MARK" > /dev/kmsg
+insmod "$WORK/final_project_proc.ko" rows="$ROWS" cols="$COLS" btn_gpios="$BTNS" led_gpios="$LEDS" \
+    debounce_us=0 irq_edge=1
+STATUS=0
+"$WORK/irqbench" --chip "$CHIP_DIR" --buttons "$BUTTONS" "$@" || STATUS=$?
+cat /proc/whackamole_stats
+
+# Only what the kernel logged during the run, the numbers are void if it complained
+dmesg | sed -n "/$MARK/,\$p" > "$WORK/dmesg.run"
+if grep -E 'BUG:|WARNING:|scheduling while atomic|sleeping function called' "$WORK/dmesg.run" >&2; then
+    echo "the kernel logged the splats above during the run, the results are not valid" >&2
+    exit 1
+fi
+exit $STATUS
@@ -0,0 +1,426 @@
+/*
+ * Hardware-in-the-loop benchmark of the whack-a-mole kernel module on a gpio-sim chip.
+ * Normally started by hil-bench.sh, which builds and loads the module against the chip.
+ *
+ * Presses are injected by pulling the simulated button lines down through sysfs, and
+ * each one is timed until its record can be read from /dev/whackamole:
+ *   inject->irq   injection to the kernel's timestamp of the press
+ *   irq->read     kernel timestamp to the record reaching user space
+ *   inject->read  the whole path
+ * LED lines are checked against WHACKAMOLE_IOC_SET_LEDS before any press is injected. The
+ * module writes LEDs from a work item, so each mask is given LED_SETTLE_NS to show up.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "whackamole_uapi.h"
+#include "whackamole_hist.h"
+
+#define DEVICE_PATH "/dev/" WHACKAMOLE_DEVICE_NAME
+#define LED_SETTLE_NS	100000000ull	// Time the LED lines get to follow a mask
+
+// One latency histogram with the same buckets as /proc/whackamole_stats
+struct hist {
+    const char *name;
+    __u32 count;
+    __u64 max_us;
+    __u32 buckets[WHACKAMOLE_HIST_BUCKETS];
+};
+
+static struct hist inject_irq = { .name = "inject->irq" };
+static struct hist irq_read = { .name = "irq->read" };
+static struct hist inject_read = { .name = "inject->read" };
+
+static const char *chip_dir;            // sysfs directory of the simulated chip
+static unsigned int buttons = 4;        // # of buttons, lines 0..buttons-1
+static unsigned int led_offset;         // First LED line, buttons by default
+static unsigned long presses = 10000;   // Presses to inject
+static unsigned long rate_hz = 1000;    // Injection rate
+static int open_loop;                   // Don't wait for each press to be read before the next one
+
+static int pull_fds[WHACKAMOLE_MAX_BUTTONS];    // sim_gpioN/pull of every button line
+static int value_fds[WHACKAMOLE_MAX_BUTTONS];   // sim_gpioN/value of every LED line
+static int dev_fd;                              // /dev/whackamole
+
+static __u64 now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (__u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void die(const char *what)
+{
+    perror(what);
+    exit(1);
+}
+
+static void hist_add(struct hist *h, __u64 ns)
+{
+    __u64 us = ns / 1000;
+
+    h->buckets[whackamole_hist_bucket(us)]++;
+    h->count++;
+    if (us > h->max_us)
+        h->max_us = us;
+}
+
+static void hist_print(const struct hist *h)
+{
+    printf("%-13s %8u %8llu %8llu %8llu %8llu\n", h->name, h->count,
+           (unsigned long long)whackamole_hist_percentile(h->buckets, h->count, 50),
+           (unsigned long long)whackamole_hist_percentile(h->buckets, h->count, 95),
+           (unsigned long long)whackamole_hist_percentile(h->buckets, h->count, 99),
+           (unsigned long long)h->max_us);
+}
+
+/**
+ * Opens an attribute of a simulated line.
+ *
+ * @param line Offset of the line on the chip.
+ * @param attr "pull" or "value".
+ * @param flags open() flags.
+ * @return The descriptor, exits on failure.
+ */
+static int open_line(unsigned int line, const char *attr, int flags)
+{
+    char path[512];
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/sim_gpio%u/%s", chip_dir, line, attr);
+    fd = open(path, flags | O_CLOEXEC);
+    if (fd < 0)
+        die(path);
+    return fd;
+}
+
+// Drives a button line, pressed buttons pull their line to ground
+static void set_button(unsigned int button, int pressed)
+{
+    const char *pull = pressed ? "pull-down" : "pull-up";
+
+    if (pwrite(pull_fds[button], pull, strlen(pull), 0) < 0)
+        die("pull");
+}
+
+static int read_led(unsigned int led)
+{
+    char value[4] = "";
+
+    if (pread(value_fds[led], value, sizeof(value) - 1, 0) < 0)
+        die("value");
+    return value[0] == '1';
+}
+
+// Reads every LED line back, bit i is set while LED i is lit
+static __u64 read_leds(void)
+{
+    __u64 lit = 0;
+
+    for (unsigned int led = 0; led < buttons; led++) {
+        if (read_led(led))
+            lit |= 1ull << led;
+    }
+    return lit;
+}
+
+/**
+ * Writes LED masks through the device and waits for the simulated lines to follow.
+ *
+ * @return # of LEDs that did not follow the command within LED_SETTLE_NS.
+ */
+static unsigned int check_leds(void)
+{
+    __u64 all = buttons == 64 ? ~0ull : (1ull << buttons) - 1;
+    unsigned int mismatches = 0, checks = 0;
+    __u64 settle_max_ns = 0;
+
+    for (unsigned int round = 0; round < buttons + 3; round++) {
+        __u64 mask;
+        if (round < buttons)
+            mask = 1ull << round;       // Walking one
+        else if (round == buttons)
+            mask = all;
+        else if (round == buttons + 1)
+            mask = 0x5555555555555555ull & all;
+        else
+            mask = 0;
+
+        __u64 t0 = now_ns(), lit;
+        if (ioctl(dev_fd, WHACKAMOLE_IOC_SET_LEDS, &mask) < 0)
+            die("WHACKAMOLE_IOC_SET_LEDS");
+        while ((lit = read_leds()) != mask && now_ns() - t0 < LED_SETTLE_NS)
+            usleep(50);
+        if (now_ns() - t0 > settle_max_ns)
+            settle_max_ns = now_ns() - t0;
+        for (unsigned int led = 0; led < buttons; led++) {
+            checks++;
+            if (!!(lit & (1ull << led)) != !!(mask & (1ull << led))) {
+                fprintf(stderr, "LED %u is %d for mask %#llx\n", led, !!(lit & (1ull << led)), (unsigned long long)mask);
+                mismatches++;
+            }
+        }
+    }
+    printf("leds: %u checks, %u mismatches, settled within %llu us\n", checks, mismatches,
+           (unsigned long long)settle_max_ns / 1000);
+    return mismatches;
+}
+
+// Reads whatever is pending, returns the # of records read
+static size_t read_events(int fd, struct whackamole_event *events, size_t max)
+{
+    ssize_t len = read(fd, events, max * sizeof(*events));
+
+    if (len < 0) {
+        if (errno == EAGAIN || errno == EINTR)
+            return 0;
+        die("read");
+    }
+    return (size_t)len / sizeof(*events);
+}
+
+static __u64 next_slot(__u64 start_ns, unsigned long i)
+{
+    return start_ns + (__u64)i * 1000000000ull / rate_hz;
+}
+
+static void sleep_until(__u64 deadline_ns)
+{
+    struct timespec ts = { deadline_ns / 1000000000ull, deadline_ns % 1000000000ull };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+/**
+ * Closed loop: every press is read back before the next one is injected, so the numbers
+ * are the latency of an idle system.
+ *
+ * @return # of presses that never showed up.
+ */
+static unsigned long run_closed_loop(void)
+{
+    unsigned long lost = 0;
+    __u64 start_ns = now_ns();
+
+    for (unsigned long i = 0; i < presses; i++) {
+        unsigned int button = i % buttons;
+        struct pollfd pfd = { dev_fd, POLLIN, 0 };
+        __u64 t0;
+        int found = 0;
+
+        sleep_until(next_slot(start_ns, i));
+        t0 = now_ns();
+        set_button(button, 1);
+        while (!found && poll(&pfd, 1, 1000) > 0) {
+            struct whackamole_event events[16];
+            size_t n = read_events(dev_fd, events, 16);
+            __u64 t1 = now_ns();
+
+            for (size_t k = 0; k < n; k++) {
+                if (events[k].type != WHACKAMOLE_EVENT_PRESS || events[k].button != button)
+                    continue;
+                hist_add(&inject_irq, events[k].timestamp_ns - t0);
+                hist_add(&irq_read, t1 - events[k].timestamp_ns);
+                hist_add(&inject_read, t1 - t0);
+                found = 1;
+            }
+        }
+        lost += !found;
+        set_button(button, 0);
+    }
+    return lost;
+}
+
+// Open loop state shared with the reader thread
+static __u64 *inject_ns;                // Injection time of every press
+static int injecting;                   // The injector has not finished yet
+static unsigned long received, gaps;    // Press records read, sequence numbers skipped
+
+/**
+ * Finds the press an event belongs to: the last injection on its button before the kernel
+ * timestamped it.
+ */
+static __u64 match_injection(const struct whackamole_event *event)
+{
+    __u64 best = 0;
+
+    for (unsigned long i = event->button; i < presses; i += buttons) {
+        __u64 t0 = __atomic_load_n(&inject_ns[i], __ATOMIC_ACQUIRE);
+        if (!t0 || t0 > event->timestamp_ns)
+            break;
+        best = t0;
+    }
+    return best;
+}
+
+static void *reader(void *arg)
+{
+    int fd = open(DEVICE_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    long long last_seq = -1;
+    __u64 idle_since = 0;
+
+    (void)arg;
+    if (fd < 0)
+        die(DEVICE_PATH);
+    for (;;) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        struct whackamole_event events[64];
+        size_t n;
+        __u64 t1;
+
+        if (poll(&pfd, 1, 100) <= 0) {
+            if (__atomic_load_n(&injecting, __ATOMIC_ACQUIRE))
+                continue;
+            if (!idle_since)
+                idle_since = now_ns();
+            else if (now_ns() - idle_since > 500000000ull)
+                break;      // Nothing for half a second after the last press
+            continue;
+        }
+        idle_since = 0;
+        n = read_events(fd, events, 64);
+        t1 = now_ns();
+        for (size_t k = 0; k < n; k++) {
+            __u64 t0;
+            if (last_seq >= 0 && events[k].seq != (__u32)(last_seq + 1))
+                gaps += events[k].seq - (__u32)(last_seq + 1);
+            last_seq = events[k].seq;
+            if (events[k].type != WHACKAMOLE_EVENT_PRESS)
+                continue;
+            received++;
+            hist_add(&irq_read, t1 - events[k].timestamp_ns);
+            t0 = match_injection(&events[k]);
+            if (t0) {
+                hist_add(&inject_irq, events[k].timestamp_ns - t0);
+                hist_add(&inject_read, t1 - t0);
+            }
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+/**
+ * Open loop: presses are injected at the requested rate no matter how fast they are read,
+ * which shows the throughput of the IRQ -> read path and its tail under load.
+ *
+ * @return # of presses that never showed up.
+ */
+static unsigned long run_open_loop(void)
+{
+    pthread_t thread;
+    __u64 start_ns;
+
+    inject_ns = calloc(presses, sizeof(*inject_ns));
+    if (!inject_ns)
+        die("calloc");
+    injecting = 1;
+    if (pthread_create(&thread, NULL, reader, NULL))
+        die("pthread_create");
+    usleep(100000);     // Let the reader open its descriptor
+
+    start_ns = now_ns();
+    for (unsigned long i = 0; i < presses; i++) {
+        unsigned int button = i % buttons;
+
+        sleep_until(next_slot(start_ns, i));
+        __atomic_store_n(&inject_ns[i], now_ns(), __ATOMIC_RELEASE);
+        set_button(button, 1);
+        set_button(button, 0);
+    }
+    printf("injected %lu presses in %.3f s\n", presses, (now_ns() - start_ns) / 1e9);
+    __atomic_store_n(&injecting, 0, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+    printf("received %lu presses, %lu events dropped by the kernel\n", received, gaps);
+    free(inject_ns);
+    return presses > received ? presses - received : 0;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s --chip DIR [options]\n"
+            "  --chip DIR         sysfs directory of the gpio-sim chip (holds sim_gpioN/)\n"
+            "  --buttons N        buttons on lines 0..N-1 (default 4)\n"
+            "  --led-offset N     first LED line (default: right after the buttons)\n"
+            "  --presses N        presses to inject (default 10000)\n"
+            "  --rate HZ          presses per second (default 1000)\n"
+            "  --open-loop        don't wait for a press to be read before injecting the next\n",
+            argv0);
+    exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct option options[] = {
+        {"chip", required_argument, NULL, 'c'},
+        {"buttons", required_argument, NULL, 'b'},
+        {"led-offset", required_argument, NULL, 'l'},
+        {"presses", required_argument, NULL, 'n'},
+        {"rate", required_argument, NULL, 'r'},
+        {"open-loop", no_argument, NULL, 'o'},
+        {NULL, 0, NULL, 0},
+    };
+    int led_offset_set = 0, opt;
+    unsigned long lost;
+    unsigned int led_errors;
+    struct whackamole_event stale[16];
+    __u64 start_ns;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+        case 'c': chip_dir = optarg; break;
+        case 'b': buttons = strtoul(optarg, NULL, 0); break;
+        case 'l': led_offset = strtoul(optarg, NULL, 0); led_offset_set = 1; break;
+        case 'n': presses = strtoul(optarg, NULL, 0); break;
+        case 'r': rate_hz = strtoul(optarg, NULL, 0); break;
+        case 'o': open_loop = 1; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (!chip_dir || !buttons || buttons > WHACKAMOLE_MAX_BUTTONS || !presses || !rate_hz)
+        usage(argv[0]);
+    if (!led_offset_set)
+        led_offset = buttons;
+
+    for (unsigned int i = 0; i < buttons; i++) {
+        pull_fds[i] = open_line(i, "pull", O_WRONLY);
+        value_fds[i] = open_line(led_offset + i, "value", O_RDONLY);
+        set_button(i, 0);
+    }
+    dev_fd = open(DEVICE_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (dev_fd < 0)
+        die(DEVICE_PATH);
+    if (ioctl(dev_fd, WHACKAMOLE_IOC_GAME_START) < 0)
+        die("WHACKAMOLE_IOC_GAME_START");
+    while (read_events(dev_fd, stale, 16))
+        ;   // Drop anything left from before
+
+    led_errors = check_leds();
+
+    start_ns = now_ns();
+    lost = open_loop ? run_open_loop() : run_closed_loop();
+    printf("%lu presses at %lu Hz, %lu lost, %.0f presses/s read\n", presses, rate_hz, lost,
+           (presses - lost) / ((now_ns() - start_ns) / 1e9));
+    printf("path          samples   p50_us   p95_us   p99_us   max_us\n");
+    hist_print(&inject_irq);
+    hist_print(&irq_read);
+    hist_print(&inject_read);
+
+    ioctl(dev_fd, WHACKAMOLE_IOC_GAME_STOP);
+    close(dev_fd);
+    return led_errors || lost ? 1 : 0;
+}
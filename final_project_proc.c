@@ -1,23 +1,65 @@
 #include<linux/init.h>
 #include<linux/module.h>
 #include<linux/kernel.h>
-#include <linux/mutex.h>	// Kernel mutex
+#include <linux/spinlock.h>	// Kernel spinlock, also taken from hrtimer callbacks
 
 #include<linux/gpio.h>      
 #include<linux/interrupt.h>
 #include<linux/delay.h>
-#include <linux/jiffies.h>
+#include <linux/moduleparam.h>	// Tunables
+#include <linux/slab.h>		// Per-reader state
+#include <linux/mutex.h>	// Readers sharing one open file
+#include <linux/ktime.h>	// Event timestamps
+#include <linux/wait.h>		// Blocking reads
+#include <linux/poll.h>		// poll()/epoll support
+#include <linux/seq_file.h>	// /proc/whackamole_stats
+#include <linux/math64.h>	// 64-bit division on 32-bit boards
+#include <linux/hrtimer.h>	// Game engine timers
+#include <linux/workqueue.h>	// GPIO writes that may sleep
+#include <linux/random.h>	// Mole selection
+#include <linux/gpio/consumer.h>	// Array updates of the LEDs
+#include <linux/bitmap.h>
 
 #include <linux/proc_fs.h>	/* Necessary because we use proc fs */
+#include <linux/miscdevice.h>	/* Binary interface at /dev/whackamole */
+#include <linux/platform_device.h>	/* The board is a platform device */
+#include <linux/of.h>		/* Boards described by the device tree */
+#include <linux/property.h>
+#include <linux/gpio/machine.h>	/* Lookup table for the pins given at load time */
+#include <linux/gpio/driver.h>	/* Chip and line of a legacy GPIO number */
+#include <linux/version.h>
+#include <linux/fs.h>
 #include <asm/uaccess.h>	/* for copy_*_user */
 
-#define NUM_BUTTONS 4				// # of buttons we're using							
+#include "whackamole_uapi.h"	// Records and ioctls shared with the game
+#include "whackamole_hist.h"	// Latency histogram buckets shared with the game
+
+#define CREATE_TRACE_POINTS
+#include "whackamole_trace.h"	// Tracepoints, free while disabled
+
+#define MAX_BUTTONS WHACKAMOLE_MAX_BUTTONS	// Largest board we support, the one in use is rows x cols
 #define PROCFS_NAME "whackamole"	// Proc file location 
-#define PROCFS_MAX_SIZE 	100  	// Sample Size    
-static DEFINE_MUTEX(lock);         
-static char PROC_BUF[PROCFS_MAX_SIZE];       //This is statically allocated, be aware this is the kernel memory.
+#define STATS_PROCFS_NAME "whackamole_stats"	// Latency statistics location
+#define EVENT_LOG_SIZE	256		// # of recent events every reader can still catch up on (must be a power of 2)
+#define EVENT_LINE_SIZE	96		// Max length of one formatted event line
+#define READ_BATCH	16		// Max events copied out of the log by one read
+#define PROC_COMMAND_SIZE	32	// Longest proc command is LEDS= with a 64-bit mask in octal (23 digits), a newline and the NUL
+
+static DEFINE_SPINLOCK(lock);   // Protects the LEDs, the statistics and the game engine, serializes event writers
+// Last EVENT_LOG_SIZE events (see whackamole_uapi.h), event seq lives in slot seq % EVENT_LOG_SIZE.
+// Written only with the lock held, read without any lock, see queue_event() and copy_events().
+static struct whackamole_event event_log[EVENT_LOG_SIZE];
+static u32 event_seq = 0;       // Sequence number given to the next button event, published after its slot is written
+static DECLARE_WAIT_QUEUE_HEAD(event_wait);     // Readers sleeping until a button event arrives
+
+// State of one open proc file or device, in file->private_data. Every reader sees every event.
+struct event_reader {
+    struct mutex read_lock;     // Serializes threads reading through the same file, writers never take it
+    u32 next_seq;   // Sequence number of the next event this reader will get
+    u32 dropped;    // # of events overwritten before this reader got to them
+};
 static bool gameActive = false;  // Tracks game state
-static bool irq_requested[NUM_BUTTONS] = {false}; // Tracks IRQs have been successfully requested
+static s32 engine_score;    // Score of the game run by the kernel, every event carries it, 0 in a game run by user space
 
 
 // ---------- PROC FUNCTIONS ----------
@@ -25,52 +67,719 @@ ssize_t procfile_read(struct file *file, char __user *user_buffer, size_t count,
 ssize_t procfile_write(struct file *file, const char __user *user_buffer, size_t count, loff_t *position);		//A write operation is requested from this file.
 static int procfile_open(struct inode *inode, struct file *file);		//File is Opened 
 static int procfile_release(struct inode *inode, struct file *file);	//A close operation is requested.
+static __poll_t event_poll(struct file *file, poll_table *wait);		//poll()/select()/epoll readiness check, shared with /dev/whackamole
 
 // proc fops struct
 static struct proc_ops proc_fops = {
 	.proc_open = procfile_open,
   	.proc_read = procfile_read,
   	.proc_write = procfile_write,
+  	.proc_poll = event_poll,
   	.proc_release = procfile_release
 };
 
+/**
+ * Attaches a new reader to the event log, shared by the proc file and the device.
+ * The reader starts at the next event, anything older belongs to whoever was reading then.
+ *
+ * @param file The file being opened, gets the reader in private_data.
+ * @return 0 on success, -ENOMEM if the reader cannot be allocated.
+ */
+static int event_reader_open(struct file *file) {
+    struct event_reader *reader = kzalloc(sizeof(*reader), GFP_KERNEL);
+
+    if (!reader) {
+        return -ENOMEM;
+    }
+    mutex_init(&reader->read_lock);
+    reader->next_seq = smp_load_acquire(&event_seq);
+    file->private_data = reader;
+    return 0;
+}
+
+// Detaches a reader from the event log
+static void event_reader_release(struct file *file) {
+    struct event_reader *reader = file->private_data;
+
+    if (reader->dropped) {
+        pr_info("A reader missed %u button events because it fell behind\n", reader->dropped);
+    }
+    kfree(reader);
+}
+
 // File is opened
 static int procfile_open(struct inode *inode, struct file *file)
 {
-	//When the file is being opened, Just print to the kernel dmesg
-    printk(KERN_INFO "proc file opend.....\t");
-    return 0;
+    return event_reader_open(file);     // Every open file reads every event
 }
 // File is released
 static int procfile_release(struct inode *inode, struct file *file)
 {
-    //When the file is being released, Just print to the kernel dmesg
-    printk(KERN_INFO "proc file released.....\n");
+    event_reader_release(file);
     return 0;
 }
 
 // ---------------------------------------
 // ---------- GPIO Declarations ----------
-static unsigned int GPIO_LEDS[] = {4, 17, 22, 6};			// GPIOs for LEDs; RED=4, BLUE=17, GREEN=22, YELLOW=6
-static unsigned int GPIO_BTNS[] = {18, 23, 12, 16};  			// GPIOs for buttons; RED=18, BLUE=23, GREEN=12, YELLOW=16
-static unsigned int irq_numbers[4];  					// IRQ numbers for each button
-
-// Debounce function for button presses
-static int button_debounce(void) {
-    static unsigned long debounce = 0;
-    unsigned long j = jiffies;
-    unsigned long stamp = j + HZ/4;  					// Debounce time of 1/4 a second
-    
-    if (time_after(j, debounce)) {
-        debounce = stamp;
-        return 1;
+// The board is rows x cols buttons with one LED each, numbered row by row. The defaults are the
+// original 2x2 cabinet, bigger cabinets pass their pin map at load time, e.g. for 4x4:
+//   insmod final_project_proc.ko rows=4 cols=4 led_gpios=<16 pins> btn_gpios=<16 pins>
+// A board can instead be described by the device tree, a node with compatible "whackamole,board",
+// led-gpios and button-gpios listing the pins row by row, and optional rows and cols properties.
+static unsigned int rows = 2;
+module_param(rows, uint, 0444);
+MODULE_PARM_DESC(rows, "Rows of buttons on the board (default 2)");
+static unsigned int cols = 2;
+module_param(cols, uint, 0444);
+MODULE_PARM_DESC(cols, "Columns of buttons on the board (default 2)");
+
+static unsigned int GPIO_LEDS[MAX_BUTTONS] = {4, 17, 22, 6};			// GPIOs for LEDs; RED=4, BLUE=17, GREEN=22, YELLOW=6
+static unsigned int num_led_gpios = 4;
+module_param_array_named(led_gpios, GPIO_LEDS, uint, &num_led_gpios, 0444);
+MODULE_PARM_DESC(led_gpios, "LED GPIO of each button, row by row (default 4,17,22,6)");
+static unsigned int GPIO_BTNS[MAX_BUTTONS] = {18, 23, 12, 16};  			// GPIOs for buttons; RED=18, BLUE=23, GREEN=12, YELLOW=16
+static unsigned int num_btn_gpios = 4;
+module_param_array_named(btn_gpios, GPIO_BTNS, uint, &num_btn_gpios, 0444);
+MODULE_PARM_DESC(btn_gpios, "Button GPIO of each button, row by row (default 18,23,12,16)");
+
+// Simulated chips (gpio-sim, gpio-mockup) only raise edge interrupts, bench/hil-bench.sh sets this
+static bool irq_edge;
+module_param(irq_edge, bool, 0444);
+MODULE_PARM_DESC(irq_edge, "Interrupt on the falling edge of a press instead of the low level (default 0)");
+
+static unsigned int num_buttons;  					// rows * cols, checked against the pin map when the board is probed
+static struct gpio_desc *led_descs[MAX_BUTTONS];	// LED descriptors, so the whole board is set in one call
+static struct gpio_array *led_array_info;			// Fast path for setting led_descs at once, NULL if they are not in chip order
+static struct gpio_desc *btn_descs[MAX_BUTTONS];	// Button descriptors
+
+// Debounce window, tunable at load time or through /sys/module/<name>/parameters/debounce_us
+static unsigned int debounce_us = 250000;
+module_param(debounce_us, uint, 0644);
+MODULE_PARM_DESC(debounce_us, "Per-button debounce window in microseconds (default 250000)");
+
+static u64 last_press_ns[MAX_BUTTONS];     // Time of the last accepted press of each button, 0 if never pressed
+
+/**
+ * Debounce function for button presses.
+ * Every button keeps its own window, so a press on one button never blocks another.
+ * Each button's IRQ thread is the only writer of its slot, so no locking is needed.
+ *
+ * @param btn_index The index of the button that fired.
+ * @param now_ns ktime_get_ns() at the time of the interrupt.
+ * @return 1 if the press is accepted, 0 if it falls inside the button's debounce window.
+ */
+static int button_debounce(int btn_index, u64 now_ns) {
+    u64 window_ns = (u64)READ_ONCE(debounce_us) * NSEC_PER_USEC;
+
+    if (last_press_ns[btn_index] && now_ns - last_press_ns[btn_index] < window_ns) {
+        trace_whackamole_debounce_reject(btn_index, now_ns, last_press_ns[btn_index]);
+        return 0;   // Still bouncing
+    }
+    last_press_ns[btn_index] = now_ns;
+    return 1;
+}
+
+// ---------- LATENCY STATS ----------
+// Reaction latency is the time from an LED being turned on to its button being pressed.
+// Everything here is protected by the lock.
+static u64 led_on_ns[MAX_BUTTONS];      // ktime_get_ns() when each LED was turned on, 0 while it is off
+static u32 press_count[MAX_BUTTONS];    // Accepted presses of each button this game
+static u32 latency_count[MAX_BUTTONS];  // Presses of each button that landed on a lit LED this game
+static u32 latency_hist[MAX_BUTTONS][WHACKAMOLE_HIST_BUCKETS];     // Reaction latency histogram of each button
+
+// Remembers when an LED was turned on, only the off -> on transition starts the clock
+static void led_stamp(int index, int on, u64 now_ns) {
+    if (!on) {
+        led_on_ns[index] = 0;
+    } else if (!led_on_ns[index]) {
+        led_on_ns[index] = now_ns;
+    }
+}
+
+static u64 led_base_mask;       // LED state the game asked for, a pattern hands its LED back to it when it ends
+static u64 pattern_mask;        // LEDs owned by a running pattern, see LED PATTERNS
+static u64 pattern_lit_mask;    // Output of every running pattern
+
+// The lock is taken from hrtimers and IRQ handlers. SoC GPIOs are written right there, so PWM
+// edges and reaction times stay exact. The GPIOs of gpio-sim and of the I2C/SPI expanders
+// bigger boards use may sleep though, for those LED changes only update the masks above with
+// the lock held and led_work writes what the board should show from process context. Changes
+// made while it runs queue it again, the LEDs always end up in the latest state.
+static bool leds_can_sleep;     // Some LED is on a GPIO chip that may sleep, set at probe
+static void leds_flush(struct work_struct *work);
+static DECLARE_WORK(led_work, leds_flush);
+
+// State the LEDs should show: the one the game asked for, overridden by running patterns. Lock held.
+static u64 leds_output(void) {
+    return (led_base_mask & ~pattern_mask) | (pattern_lit_mask & pattern_mask);
+}
+
+// led_work, writes the LED state to the GPIOs where the GPIO calls may sleep
+static void leds_flush(struct work_struct *work) {
+    DECLARE_BITMAP(values, MAX_BUTTONS);
+    unsigned long flags;
+    u64 mask;
+
+    spin_lock_irqsave(&lock, flags);
+    mask = leds_output();
+    spin_unlock_irqrestore(&lock, flags);
+    bitmap_from_u64(values, mask);
+    gpiod_set_array_value_cansleep(num_buttons, led_descs, led_array_info, values);   // One set_multiple() per GPIO chip
+}
+
+// Shows the state of one LED after the masks changed. Must be called with the lock held.
+static void led_sync(int index) {
+    if (leds_can_sleep) {
+        queue_work(system_highpri_wq, &led_work);
+        return;
+    }
+    gpiod_set_value(led_descs[index], (leds_output() >> index) & 1);
+}
+
+// Shows the state of every LED after the masks changed. Must be called with the lock held.
+static void leds_sync(void) {
+    DECLARE_BITMAP(values, MAX_BUTTONS);
+
+    if (leds_can_sleep) {
+        queue_work(system_highpri_wq, &led_work);
+        return;
+    }
+    bitmap_from_u64(values, leds_output());
+    gpiod_set_array_value(num_buttons, led_descs, led_array_info, values);   // One set_multiple() per GPIO chip
+}
+
+/**
+ * Sets an LED and remembers when it was turned on.
+ * An LED that runs a pattern keeps it, only the state it goes back to afterwards changes.
+ * Must be called with the lock held.
+ *
+ * @param index Index of the LED.
+ * @param on Nonzero to turn the LED on.
+ * @param now_ns ktime_get_ns() at the time of the command.
+ */
+static void led_write(int index, int on, u64 now_ns) {
+    led_stamp(index, on, now_ns);
+    if (on) {
+        led_base_mask |= BIT_ULL(index);
+    } else {
+        led_base_mask &= ~BIT_ULL(index);
+    }
+    if (!(pattern_mask & BIT_ULL(index))) {
+        led_sync(index);
+    }
+    trace_whackamole_led_set(index, on);
+}
+
+/**
+ * Sets every LED of the board from a bitmask in a single GPIO array update.
+ * LEDs that run a pattern keep showing it, like in led_write().
+ * Must be called with the lock held.
+ *
+ * @param mask Bit i turns LED i on, bits beyond the board are ignored.
+ * @param now_ns ktime_get_ns() at the time of the command.
+ */
+static void leds_write_mask(u64 mask, u64 now_ns) {
+    for (unsigned int i = 0; i < num_buttons; i++) {
+        led_stamp(i, (mask >> i) & 1, now_ns);
+    }
+    led_base_mask = mask;
+    leds_sync();
+    trace_whackamole_leds_set(mask);
+}
+
+/**
+ * Accounts a press in the button's statistics.
+ * Must be called with the lock held, before the LED is toggled.
+ *
+ * @param btn_index The index of the button that was pressed.
+ * @param now_ns ktime_get_ns() at the time of the press.
+ * @return The reaction time in microseconds, 0 if the LED was off.
+ */
+static u32 record_press(int btn_index, u64 now_ns) {
+    u64 latency_us;
+
+    press_count[btn_index]++;
+    if (!led_on_ns[btn_index]) {
+        return 0;   // Only presses on a lit LED have a reaction time
+    }
+    latency_us = div_u64(now_ns - led_on_ns[btn_index], NSEC_PER_USEC);
+    latency_hist[btn_index][whackamole_hist_bucket(latency_us)]++;
+    latency_count[btn_index]++;
+    return latency_us;
+}
+
+/**
+ * Appends an event to the log and numbers it. The oldest event is overwritten, readers
+ * that had not read it yet account for it on their own.
+ * Must be called with the lock held, which makes this the only writer, so the log needs no
+ * lock of its own and never waits for a reader. Readers are woken up by the caller once the
+ * lock is released.
+ *
+ * @param type enum whackamole_event_type
+ * @param button Index of the button the event refers to.
+ * @param now_ns ktime_get_ns() at the time of the event.
+ * @param score Score after the event.
+ * @param latency_us Reaction time, 0 if there is none.
+ */
+static void queue_event(u16 type, int button, u64 now_ns, s32 score, u32 latency_us) {
+    u32 seq = event_seq;
+    struct whackamole_event *slot = &event_log[seq % EVENT_LOG_SIZE];
+
+    // Readers check the slot's seq before and after copying it. While it is being rewritten
+    // it holds a number that never belongs to this slot, so a torn copy is always noticed.
+    WRITE_ONCE(slot->seq, seq - 1);
+    smp_wmb();
+    slot->type = type;
+    slot->button = button;
+    slot->timestamp_ns = now_ns;
+    slot->score = score;
+    slot->latency_us = latency_us;
+    smp_store_release(&slot->seq, seq);
+    smp_store_release(&event_seq, seq + 1);    // Publish, pairs with the acquire in copy_events()
+}
+
+// ---------- LED PATTERNS ----------
+// Blinks, flashes and dimmed LEDs run here on one hrtimer shared by every LED, so visual
+// feedback is timed by the kernel and needs no command per transition from user space.
+// A pattern cycles through a lit and a dark phase. Brightness below full is software PWM
+// during the lit phase. Everything here is protected by the lock.
+#define PATTERN_PWM_PERIOD_NS	(5 * NSEC_PER_MSEC)	// 200 Hz, fast enough not to flicker
+#define PATTERN_FOREVER		U64_MAX				// Phase or transition that never comes
+
+struct led_pattern {
+    u64 on_ns;          // Lit phase of a cycle, PATTERN_FOREVER for a dimmed LED
+    u64 off_ns;         // Dark phase of a cycle, 0 for none
+    u64 high_ns;        // Time the LED is on in every PWM period of the lit phase
+    u32 repeat;         // # of cycles, 0 for no end
+    u32 cycles;         // Cycles completed so far
+    bool lit_phase;     // In the lit phase of the cycle
+    u64 phase_end_ns;   // End of the current phase
+    u64 next_ns;        // Next transition of the LED
+};
+
+static struct led_pattern led_patterns[MAX_BUTTONS];
+static struct hrtimer pattern_timer;    // Runs the transitions that are due, armed for the earliest one
+
+// Timing of the fixed flashes, the kernel-run game plays them on hits and misses
+static const struct whackamole_led_pattern HIT_FLASH = { .brightness = 255, .on_ms = 40, .off_ms = 40, .repeat = 3 };
+static const struct whackamole_led_pattern MISS_FLASH = { .brightness = 48, .on_ms = 150, .off_ms = 0, .repeat = 1 };
+
+// Drives the output of a pattern, the state the game asked for is left alone
+static void pattern_output(int index, bool on) {
+    if (on) {
+        pattern_lit_mask |= BIT_ULL(index);
+    } else {
+        pattern_lit_mask &= ~BIT_ULL(index);
+    }
+    led_sync(index);
+    trace_whackamole_led_set(index, on);
+}
+
+/**
+ * Starts the lit phase of a cycle.
+ *
+ * @param index Index of the LED.
+ * @param start_ns When the phase starts. Cycles are timed from when they were due, not from
+ * when the timer ran, so a pattern does not drift.
+ */
+static void pattern_begin_cycle(int index, u64 start_ns) {
+    struct led_pattern *p = &led_patterns[index];
+
+    p->lit_phase = true;
+    p->phase_end_ns = p->on_ns == PATTERN_FOREVER ? PATTERN_FOREVER : start_ns + p->on_ns;
+    pattern_output(index, p->high_ns > 0);
+    if (p->high_ns > 0 && p->high_ns < PATTERN_PWM_PERIOD_NS) {
+        p->next_ns = min(start_ns + p->high_ns, p->phase_end_ns);
+    } else {
+        p->next_ns = p->phase_end_ns;   // Full on or full off, no PWM edges
+    }
+}
+
+/**
+ * Runs the transition of a pattern that is due: a PWM edge, the end of the lit phase or the
+ * end of a cycle.
+ *
+ * @param index Index of the LED.
+ * @return false once the last cycle is over.
+ */
+static bool pattern_step(int index) {
+    struct led_pattern *p = &led_patterns[index];
+    u64 at_ns = p->next_ns;
+
+    if (at_ns < p->phase_end_ns) {
+        bool on = !(pattern_lit_mask & BIT_ULL(index));     // PWM edge inside the lit phase
+
+        pattern_output(index, on);
+        p->next_ns = min(at_ns + (on ? p->high_ns : PATTERN_PWM_PERIOD_NS - p->high_ns), p->phase_end_ns);
+        return true;
+    }
+    if (p->lit_phase && p->off_ns) {
+        p->lit_phase = false;
+        p->phase_end_ns = at_ns + p->off_ns;
+        p->next_ns = p->phase_end_ns;
+        pattern_output(index, false);
+        return true;
+    }
+    if (p->repeat && ++p->cycles >= p->repeat) {
+        return false;
+    }
+    pattern_begin_cycle(index, at_ns);
+    return true;
+}
+
+// Hands an LED back to the state the game asked for
+static void pattern_end(int index) {
+    bool on = (led_base_mask >> index) & 1;
+
+    pattern_mask &= ~BIT_ULL(index);
+    pattern_lit_mask &= ~BIT_ULL(index);
+    led_sync(index);
+    trace_whackamole_led_set(index, on);
+}
+
+// Drops every pattern without touching the LEDs, the caller sets them right after
+static void patterns_clear(void) {
+    pattern_mask = 0;
+    pattern_lit_mask = 0;
+}
+
+// Earliest transition of any running pattern, PATTERN_FOREVER if there is none
+static u64 pattern_next_ns(void) {
+    u64 next_ns = PATTERN_FOREVER;
+
+    for (unsigned int i = 0; i < num_buttons; i++) {
+        if (pattern_mask & BIT_ULL(i)) {
+            next_ns = min(next_ns, led_patterns[i].next_ns);
+        }
+    }
+    return next_ns;
+}
+
+/**
+ * Starts a pattern on an LED, replacing the one it was running.
+ * Must be called with the lock held.
+ *
+ * @param desc The pattern, see struct whackamole_led_pattern.
+ * @param now_ns ktime_get_ns() at the time of the command, the first cycle starts here.
+ * @return 0 on success, -EINVAL for a bad LED, an unknown kind or a BLINK without a lit phase.
+ */
+static int pattern_start(const struct whackamole_led_pattern *desc, u64 now_ns) {
+    const struct whackamole_led_pattern *timing = desc;
+    struct led_pattern *p;
+    u64 next_ns;
+
+    if (desc->led >= num_buttons || desc->reserved) {
+        return -EINVAL;
+    }
+    p = &led_patterns[desc->led];
+
+    switch (desc->kind) {
+    case WHACKAMOLE_PATTERN_NONE:
+        if (pattern_mask & BIT_ULL(desc->led)) {
+            pattern_end(desc->led);     // A timer armed for it finds nothing to do
+        }
+        return 0;
+    case WHACKAMOLE_PATTERN_BLINK:
+        if (!desc->on_ms) {
+            return -EINVAL;
+        }
+        break;
+    case WHACKAMOLE_PATTERN_HIT_FLASH:
+        timing = &HIT_FLASH;
+        break;
+    case WHACKAMOLE_PATTERN_MISS_FLASH:
+        timing = &MISS_FLASH;
+        break;
+    case WHACKAMOLE_PATTERN_DIM:
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    p->high_ns = div_u64((u64)PATTERN_PWM_PERIOD_NS * timing->brightness, 255);
+    if (desc->kind == WHACKAMOLE_PATTERN_DIM) {
+        p->on_ns = PATTERN_FOREVER;
+        p->off_ns = 0;
+        p->repeat = 0;
+    } else {
+        p->on_ns = (u64)timing->on_ms * NSEC_PER_MSEC;
+        p->off_ns = (u64)timing->off_ms * NSEC_PER_MSEC;
+        p->repeat = timing->repeat;
+    }
+    p->cycles = 0;
+    pattern_mask |= BIT_ULL(desc->led);
+    pattern_begin_cycle(desc->led, now_ns);
+
+    // Only ever move the timer earlier, its callback re-arms it for whatever is left
+    next_ns = pattern_next_ns();
+    if (next_ns != PATTERN_FOREVER && (!hrtimer_is_queued(&pattern_timer)
+                                       || next_ns < ktime_to_ns(hrtimer_get_expires(&pattern_timer)))) {
+        hrtimer_start(&pattern_timer, ns_to_ktime(next_ns), HRTIMER_MODE_ABS);
     }
     return 0;
 }
 
+// Pattern timer callback, runs every transition that is due and reports the patterns that ended
+static enum hrtimer_restart pattern_timer_fn(struct hrtimer *timer) {
+    enum hrtimer_restart restart = HRTIMER_NORESTART;
+    unsigned long flags;
+    u64 now_ns = ktime_get_ns();
+    bool ended = false;
+    u64 next_ns;
+
+    spin_lock_irqsave(&lock, flags);
+    for (unsigned int i = 0; i < num_buttons; i++) {
+        // A late callback catches up on every missed transition, so the pattern keeps its timing
+        while ((pattern_mask & BIT_ULL(i)) && led_patterns[i].next_ns <= now_ns) {
+            if (!pattern_step(i)) {
+                pattern_end(i);
+                queue_event(WHACKAMOLE_EVENT_PATTERN_DONE, i, now_ns, engine_score, 0);
+                ended = true;
+            }
+        }
+    }
+    // pattern_start() may have queued the timer again while we waited for the lock, it then stays as it is
+    next_ns = pattern_next_ns();
+    if (next_ns != PATTERN_FOREVER && !hrtimer_is_queued(timer)) {
+        hrtimer_set_expires(timer, ns_to_ktime(next_ns));
+        restart = HRTIMER_RESTART;
+    }
+    spin_unlock_irqrestore(&lock, flags);
+    if (ended) {
+        wake_up_interruptible(&event_wait);
+    }
+    return restart;
+}
+
+// Prepares the pattern timer at module load
+static void patterns_init(void) {
+    hrtimer_init(&pattern_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    pattern_timer.function = pattern_timer_fn;
+}
+
+// ---------- GAME ENGINE ----------
+// Optional mode where the module runs the whole game: hrtimers pop moles up and take them
+// down, presses are judged right in the IRQ path, and the results are streamed as events.
+// The board is a bitmask of the moles that are up, each with its own deadline, so several
+// moles can be up at once. Everything here is protected by the lock.
+static struct whackamole_engine_config engine_config;     // Rules of the running game
+static bool engine_active = false;     // The kernel is running the game
+static u64 engine_moles;            // Bit i is set while mole i is up
+static u64 engine_mole_deadline_ns[MAX_BUTTONS];   // When each mole that is up goes away
+static struct hrtimer round_timer;  // Ends the round
+static struct hrtimer spawn_timer;  // Pops up the next mole, periodic
+static struct hrtimer expire_timer; // Takes down the moles whose window ran out, armed for the earliest deadline
+
+// Index of the n-th set bit of a mask, counting from 0, the mask must have more than n bits set
+static int nth_set_bit(u64 mask, unsigned int n) {
+    while (n--) {
+        mask &= mask - 1;   // Drop the lowest set bit
+    }
+    return __ffs64(mask);
+}
+
+// Earliest deadline of the moles that are up, U64_MAX if none is up
+static u64 engine_next_deadline(void) {
+    u64 next_ns = U64_MAX;
+
+    for (u64 up = engine_moles; up; up &= up - 1) {
+        next_ns = min(next_ns, engine_mole_deadline_ns[__ffs64(up)]);
+    }
+    return next_ns;
+}
+
+/**
+ * Pops up a random mole in a hole that has none. On a full board the mole with the earliest
+ * deadline, which is the oldest one, goes away first without penalty.
+ * Must be called with the lock held.
+ *
+ * @param now_ns ktime_get_ns() at the time of the spawn.
+ */
+static void engine_spawn(u64 now_ns) {
+    u64 holes;
+    int index = 0;
+
+    if (hweight64(engine_moles) >= engine_config.max_moles) {
+        u64 oldest_ns = engine_next_deadline();
+
+        for (u64 up = engine_moles; up; up &= up - 1) {
+            index = __ffs64(up);
+            if (engine_mole_deadline_ns[index] == oldest_ns) {
+                break;
+            }
+        }
+        engine_moles &= ~BIT_ULL(index);
+        led_write(index, 0, now_ns);
+        queue_event(WHACKAMOLE_EVENT_MOLE_HIDDEN, index, now_ns, engine_score, 0);
+    }
+
+    holes = GENMASK_ULL(num_buttons - 1, 0) & ~engine_moles;
+    index = nth_set_bit(holes, get_random_u32() % hweight64(holes));     // Randomly select a free hole
+    engine_moles |= BIT_ULL(index);
+    engine_mole_deadline_ns[index] = now_ns + (u64)engine_config.mole_window_ms * NSEC_PER_MSEC;
+    led_write(index, 1, now_ns);
+    // The new deadline is the latest, so an armed timer is already early enough.
+    // The expiry callback may be waiting for the lock, it leaves a queued timer alone.
+    if (!hrtimer_is_queued(&expire_timer)) {
+        hrtimer_start(&expire_timer, ns_to_ktime(engine_next_deadline()), HRTIMER_MODE_ABS);
+    }
+    queue_event(WHACKAMOLE_EVENT_MOLE_SHOWN, index, now_ns, engine_score, 0);
+}
+
+/**
+ * Judges a press against the hole of the button and flashes the button's LED accordingly.
+ * Must be called with the lock held.
+ *
+ * @param btn_index The index of the button that was pressed.
+ * @param now_ns Time of the press.
+ * @param latency_us Reaction time of the press, 0 if the LED was off.
+ */
+static void engine_judge_press(int btn_index, u64 now_ns, u32 latency_us) {
+    struct whackamole_led_pattern flash = { .led = btn_index };
+
+    if ((engine_moles & BIT_ULL(btn_index)) && now_ns <= engine_mole_deadline_ns[btn_index]) {
+        engine_score += engine_config.hit_points;
+        engine_moles &= ~BIT_ULL(btn_index);    // The expiry callback ignores a mole that is gone
+        led_write(btn_index, 0, now_ns);
+        flash.kind = WHACKAMOLE_PATTERN_HIT_FLASH;
+        pattern_start(&flash, now_ns);
+        queue_event(WHACKAMOLE_EVENT_HIT, btn_index, now_ns, engine_score, latency_us);
+    } else {
+        engine_score += engine_config.miss_points;
+        flash.kind = WHACKAMOLE_PATTERN_MISS_FLASH;
+        pattern_start(&flash, now_ns);
+        queue_event(WHACKAMOLE_EVENT_MISS, btn_index, now_ns, engine_score, 0);
+    }
+}
+
+/**
+ * Ends the running game, turns every LED off and reports the final score.
+ * Must be called with the lock held. The timers stop on their own once engine_active is false.
+ *
+ * @param now_ns ktime_get_ns() at the end of the game.
+ */
+static void engine_finish(u64 now_ns) {
+    if (!engine_active) {
+        return;
+    }
+    engine_active = false;
+    gameActive = false;
+    engine_moles = 0;
+    patterns_clear();
+    leds_write_mask(0, now_ns);
+    queue_event(WHACKAMOLE_EVENT_GAME_OVER, 0, now_ns, engine_score, 0);
+}
+
+// Spawn timer callback, pops up the next mole every spawn_interval_ms
+static enum hrtimer_restart spawn_timer_fn(struct hrtimer *timer) {
+    unsigned long flags;
+    bool active;
+
+    spin_lock_irqsave(&lock, flags);
+    active = engine_active;
+    if (active) {
+        engine_spawn(ktime_get_ns());
+    }
+    spin_unlock_irqrestore(&lock, flags);
+    if (!active) {
+        return HRTIMER_NORESTART;
+    }
+    wake_up_interruptible(&event_wait);
+    hrtimer_forward_now(timer, ms_to_ktime(engine_config.spawn_interval_ms));   // Next spawn stays on the original grid
+    return HRTIMER_RESTART;
+}
+
+// Expiry timer callback, takes down every mole nobody whacked in time and waits for the next deadline
+static enum hrtimer_restart expire_timer_fn(struct hrtimer *timer) {
+    enum hrtimer_restart restart = HRTIMER_NORESTART;
+    unsigned long flags;
+    u64 now_ns = ktime_get_ns();
+    u64 next_ns;
+
+    spin_lock_irqsave(&lock, flags);
+    if (!engine_active) {
+        spin_unlock_irqrestore(&lock, flags);
+        return HRTIMER_NORESTART;
+    }
+    // Moles spawned while we waited for the lock have their deadlines still ahead
+    for (u64 up = engine_moles; up; up &= up - 1) {
+        int index = __ffs64(up);
+
+        if (now_ns >= engine_mole_deadline_ns[index]) {
+            engine_score += engine_config.timeout_points;
+            engine_moles &= ~BIT_ULL(index);
+            led_write(index, 0, now_ns);
+            queue_event(WHACKAMOLE_EVENT_TIMEOUT, index, now_ns, engine_score, 0);
+        }
+    }
+    // engine_spawn() may have queued the timer again while we waited for the lock, it then stays as it is
+    next_ns = engine_next_deadline();
+    if (next_ns != U64_MAX && !hrtimer_is_queued(timer)) {
+        hrtimer_set_expires(timer, ns_to_ktime(next_ns));
+        restart = HRTIMER_RESTART;
+    }
+    spin_unlock_irqrestore(&lock, flags);
+    wake_up_interruptible(&event_wait);
+    return restart;
+}
+
+// Round timer callback, ends the game
+static enum hrtimer_restart round_timer_fn(struct hrtimer *timer) {
+    unsigned long flags;
+
+    spin_lock_irqsave(&lock, flags);
+    engine_finish(ktime_get_ns());
+    spin_unlock_irqrestore(&lock, flags);
+    wake_up_interruptible(&event_wait);
+    return HRTIMER_NORESTART;
+}
+
+// Stops every engine timer, must be called without the lock held from process context
+static void engine_cancel_timers(void) {
+    hrtimer_cancel(&round_timer);
+    hrtimer_cancel(&spawn_timer);
+    hrtimer_cancel(&expire_timer);
+}
+
+// Prepares the engine timers at module load
+static void engine_init(void) {
+    hrtimer_init(&round_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    round_timer.function = round_timer_fn;
+    hrtimer_init(&spawn_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    spawn_timer.function = spawn_timer_fn;
+    hrtimer_init(&expire_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    expire_timer.function = expire_timer_fn;
+}
+
+// Clears the statistics, called when a new game starts. Must be called with the lock held.
+static void reset_stats(void) {
+    memset(press_count, 0, sizeof(press_count));
+    memset(latency_count, 0, sizeof(latency_count));
+    memset(latency_hist, 0, sizeof(latency_hist));
+}
+
+static u64 irq_stamp_ns[MAX_BUTTONS];     // Time of the interrupt, set by the hard handler for the IRQ thread
+
+/**
+ * Hard IRQ handler for button presses.
+ * Only timestamps the interrupt, so the time of the press does not depend on when the
+ * IRQ thread gets scheduled. The line stays masked until the thread is done (IRQF_ONESHOT).
+ *
+ * @param irq The IRQ number associated with the interrupt.
+ * @param dev_id Device ID used to get the button index.
+ * @return IRQ_WAKE_THREAD to run button_irq_handler.
+ */
+static irqreturn_t button_hardirq_handler(int irq, void *dev_id) {
+    irq_stamp_ns[(size_t)dev_id] = ktime_get_ns();
+    return IRQ_WAKE_THREAD;
+}
+
 /**
  * IRQ handler for button presses.
- * Toggles the corresponding LED and logs the button press to the /proc file.
+ * Queues a timestamped event for the readers. When the kernel runs the game the press is
+ * judged against the mole that is up, otherwise the corresponding LED is toggled.
+ * Nothing here sleeps or waits for a reader, the lock only covers game state and the log
+ * write, so the handler is also safe to run in hard IRQ context.
  *
  * @param irq The IRQ number associated with the interrupt.
  * @param dev_id Device ID used to get the button index.
@@ -78,102 +787,398 @@ static int button_debounce(void) {
  */
 static irqreturn_t button_irq_handler(int irq, void *dev_id) {
     int btn_index = (int)(size_t)dev_id;    // Convert device ID to button index
-    unsigned int led_gpio = GPIO_LEDS[btn_index];   // Get GPIO for the corresponding LED
+    u64 now_ns = irq_stamp_ns[btn_index];   // Time of the press, taken by the hard handler
+
+    // Fallback for a zero stamp, when the hard handler did not stamp this press: the press is then
+    // stamped here, later than the IRQ by the thread's wakeup, and latency numbers include that.
+    // IRQF_ONESHOT keeps the line masked until we return, so clearing the stamp can't race.
+    if (!now_ns)
+        now_ns = ktime_get_ns();
+    irq_stamp_ns[btn_index] = 0;
+    trace_whackamole_irq(btn_index, now_ns);
 
     // Checking if the button is toggled
-    if (button_debounce() && gameActive) {
-        bool is_on; 
+    if (button_debounce(btn_index, now_ns) && gameActive) {
+        unsigned long flags;
+        u32 latency_us;
 
-        mutex_lock(&lock);  // Lock mutex to protect the LED toggling and button presses
-        is_on = gpio_get_value(led_gpio);   // Get current state of LED
-        gpio_set_value(led_gpio, !is_on);  // Toggle LED
-        snprintf(PROC_BUF, PROCFS_MAX_SIZE, "Button %d pressed", btn_index);  // Write button press info in PROC_BUF
-        mutex_unlock(&lock);    // unlock the mutex
+        spin_lock_irqsave(&lock, flags);  // Lock to protect the LEDs, the event log and the game
+        latency_us = record_press(btn_index, now_ns);    // Reaction time against the LED being turned on
+        queue_event(WHACKAMOLE_EVENT_PRESS, btn_index, now_ns, engine_score, latency_us);
+        if (engine_active) {
+            engine_judge_press(btn_index, now_ns, latency_us);     // The engine owns the LEDs
+        } else {
+            led_write(btn_index, !((led_base_mask >> btn_index) & 1), now_ns);  // Toggle LED
+            led_on_ns[btn_index] = 0;   // A toggle is not a mole, don't time it
+        }
+        spin_unlock_irqrestore(&lock, flags);    // unlock
+        wake_up_interruptible(&event_wait);     // Wake up any blocked readers and pollers
 
-        pr_info("LED on GPIO %d toggled, Button %d pressed\n", led_gpio, btn_index);    // print previous action to the kernel
+        pr_debug("Button %d pressed\n", btn_index);    // print previous action to the kernel when dynamic debug asks for it
     }
     return IRQ_HANDLED;     // IRQ has been handled
 }
 
 /**
- * Function to configure GPIOs and IRQs for each button.
- * Sets up the GPIO pins for input (buttons) and output (LEDs), and requests IRQs
+ * Gets the LED and button GPIOs of the board, every LED starts off.
+ * Each list is requested as one array, from the led-gpios and button-gpios properties of a
+ * device tree board or from the lookup table the module adds for the pins given at load time.
+ * Everything is device-managed, so a failure here or later in probe releases whatever was
+ * already requested.
  *
- * @param btn_index The index of the button in the GPIO arrays.
- * @return 0 on successful setup, -ENODEV if GPIO validation fails, or a negative error code if IRQ request fails.
+ * @param dev The board's platform device.
+ * @return 0 on success, or a negative error code.
  */
-static int setup_button_irq(int btn_index) {
-    int retval;
-    unsigned int btn_gpio = GPIO_BTNS[btn_index];		// Button GPIO number
-    unsigned int led_gpio = GPIO_LEDS[btn_index];		// Corresponding LED GPIO number
-
-    // Validate the GPIO numbers for the button and LED
-    if (!gpio_is_valid(led_gpio) || !gpio_is_valid(btn_gpio)){
-        pr_info("GPIO invalid: LED %d or Button %d\n", led_gpio, btn_gpio);
-        return -ENODEV;     // Return device not found error
-    }
-
-	// Request GPIOs for buttons and LEDs
-    gpio_request(btn_gpio, "GPIO_BTN");
-    gpio_request(led_gpio, "GPIO_LED");
-    
-    // Set directions for GPIOs
-    gpio_direction_input(btn_gpio);
-    gpio_direction_output(led_gpio, 0);
-
-	// Map the button GPIO to IRQ number 
-    irq_numbers[btn_index] = gpio_to_irq(btn_gpio);
-    
-    // set up threaded IRQ handler for handling button presses
-	retval = request_threaded_irq(irq_numbers[btn_index], NULL, button_irq_handler, IRQF_TRIGGER_LOW | IRQF_ONESHOT, "MyCustomIRQProc", (void *)(size_t)btn_index);
-    if (retval) {
-        pr_info("Unable to request IRQ: %d for Button %d\n", retval, btn_index);
-        return retval;
-    } else {
-        irq_requested[btn_index] = true; // Mark this IRQ as successfully requested
+static int board_get_gpios(struct device *dev) {
+    struct gpio_descs *leds, *btns;
+
+    leds = devm_gpiod_get_array(dev, "led", GPIOD_OUT_LOW);
+    if (IS_ERR(leds)) {
+        return dev_err_probe(dev, PTR_ERR(leds), "Unable to get the LED GPIOs\n");
+    }
+    btns = devm_gpiod_get_array(dev, "button", GPIOD_IN);
+    if (IS_ERR(btns)) {
+        return dev_err_probe(dev, PTR_ERR(btns), "Unable to get the button GPIOs\n");
     }
+    if (leds->ndescs != num_buttons || btns->ndescs != num_buttons) {
+        dev_err(dev, "Board %ux%u needs %u LED and button GPIOs, got %u and %u\n", rows, cols, num_buttons, leds->ndescs, btns->ndescs);
+        return -EINVAL;
+    }
+    memcpy(led_descs, leds->desc, num_buttons * sizeof(*led_descs));
+    memcpy(btn_descs, btns->desc, num_buttons * sizeof(*btn_descs));
+    led_array_info = leds->info;    // Lets the whole board be set with one write per GPIO chip
+    leds_can_sleep = false;
+    for (unsigned int i = 0; i < num_buttons; i++) {
+        leds_can_sleep |= gpiod_cansleep(led_descs[i]);
+    }
+    return 0;
+}
+
+/**
+ * Requests the threaded IRQ of every button, device-managed like the GPIOs.
+ *
+ * @param dev The board's platform device.
+ * @return 0 on success, or a negative error code.
+ */
+static int board_request_irqs(struct device *dev) {
+    unsigned long trigger = irq_edge ? IRQF_TRIGGER_FALLING : IRQF_TRIGGER_LOW;
+
+    for (int i = 0; i < num_buttons; i++) {
+        int irq = gpiod_to_irq(btn_descs[i]);     // Map the button GPIO to its IRQ number
+        int retval;
+
+        if (irq < 0) {
+            return dev_err_probe(dev, irq, "No IRQ for button %d\n", i);
+        }
+        retval = devm_request_threaded_irq(dev, irq, button_hardirq_handler, button_irq_handler,
+                                           trigger | IRQF_ONESHOT, "MyCustomIRQProc", (void *)(size_t)i);
+        if (retval) {
+            return dev_err_probe(dev, retval, "Unable to request IRQ %d for button %d\n", irq, i);
+        }
+    }
+    return 0;
+}
+
+
+// ---------- GAME CONTROL ----------
+
+// Starts the game, button presses are reported from now on and LEDs are driven by user space
+static void game_start(void) {
+    unsigned long flags;
+
+    spin_lock_irqsave(&lock, flags);
+    engine_active = false;  // User space runs the game
+    engine_score = 0;
+    reset_stats();  // Statistics cover one game
+    gameActive = true;  // Set game as active
+    spin_unlock_irqrestore(&lock, flags);
+    engine_cancel_timers();
+    pr_info("Game started\n");
+}
+
+// Stops the game, including one run by the kernel, and turns off every LED
+static void game_stop(void) {
+    unsigned long flags;
+    u64 now_ns = ktime_get_ns();
+
+    spin_lock_irqsave(&lock, flags);
+    engine_finish(now_ns);  // Reports the final score if the kernel was running the game
+    gameActive = false;  // Set game as inactive
+    patterns_clear();
+    leds_write_mask(0, now_ns);  // Turn off all LEDS when the game stops
+    spin_unlock_irqrestore(&lock, flags);
+    engine_cancel_timers();
+    wake_up_interruptible(&event_wait);
+    pr_info("Game stopped\n");
+}
+
+/**
+ * Starts a game run by the kernel.
+ * The first mole pops up after one spawn interval, like in the GUI.
+ *
+ * @param config Rules of the game.
+ * @return 0 on success, -EINVAL if a duration is zero.
+ */
+static int engine_start(const struct whackamole_engine_config *config) {
+    unsigned long flags;
+
+    if (!config->duration_ms || !config->spawn_interval_ms || !config->mole_window_ms) {
+        return -EINVAL;
+    }
+    engine_cancel_timers();     // Leftovers of a previous game
+
+    spin_lock_irqsave(&lock, flags);
+    engine_config = *config;
+    engine_config.max_moles = clamp_t(u32, config->max_moles, 1, num_buttons);
+    engine_score = 0;
+    engine_moles = 0;
+    reset_stats();  // Statistics cover one game
+    patterns_clear();
+    leds_write_mask(0, 0);
+    engine_active = true;
+    gameActive = true;
+    hrtimer_start(&round_timer, ms_to_ktime(config->duration_ms), HRTIMER_MODE_REL);
+    hrtimer_start(&spawn_timer, ms_to_ktime(config->spawn_interval_ms), HRTIMER_MODE_REL);
+    spin_unlock_irqrestore(&lock, flags);
+    pr_info("Game started, run by the kernel\n");
+    return 0;
+}
+
+/**
+ * Turns a single LED on, ignored while the game is stopped or run by the kernel.
+ *
+ * @param index Index of the LED.
+ */
+static void led_on(int index) {
+    unsigned long flags;
+    u64 now_ns = ktime_get_ns();
+
+    spin_lock_irqsave(&lock, flags);
+    if (gameActive && !engine_active) {
+        led_write(index, 1, now_ns);
+    }
+    spin_unlock_irqrestore(&lock, flags);
+}
+
+/**
+ * Drives every LED from a bitmask, bit i controls LED i.
+ * Ignored while the game is stopped or run by the kernel, like the single LED commands.
+ *
+ * @param mask Bitmask of the LEDs to turn on, every other LED is turned off.
+ */
+static void set_leds(u64 mask) {
+    unsigned long flags;
+    u64 now_ns = ktime_get_ns();    // Moment the moles become visible
+
+    spin_lock_irqsave(&lock, flags);
+    if (gameActive && !engine_active) {
+        leds_write_mask(mask, now_ns);
+    }
+    spin_unlock_irqrestore(&lock, flags);
+}
+
+/**
+ * Plays a pattern on one LED, ignored while the game is stopped like the LED commands.
+ *
+ * @param pattern The pattern, see struct whackamole_led_pattern.
+ * @return 0 on success, -EINVAL for a bad pattern.
+ */
+static int set_pattern(const struct whackamole_led_pattern *pattern) {
+    unsigned long flags;
+    int retval = 0;
+
+    spin_lock_irqsave(&lock, flags);
+    if (gameActive) {
+        retval = pattern_start(pattern, ktime_get_ns());
+    }
+    spin_unlock_irqrestore(&lock, flags);
+    return retval;
+}
+
+// True if the reader has not caught up with the log
+static bool events_pending(const struct event_reader *reader) {
+    return smp_load_acquire(&event_seq) != READ_ONCE(reader->next_seq);
+}
+
+/**
+ * Copies a reader's next events out of the log without taking the lock, so neither the
+ * IRQ handler nor the engine ever waits for a reader.
+ * A slot is only accepted if it holds the expected sequence number both before and after
+ * the copy. Otherwise the writer lapped the reader, which skips to the oldest event that is
+ * still safe to read and accounts for the skipped ones.
+ *
+ * @param reader The reader, with its read_lock held.
+ * @param events Where to store the events.
+ * @param max Maximum number of events to copy.
+ * @return The number of events copied.
+ */
+static unsigned int copy_events(struct event_reader *reader, struct whackamole_event *events, unsigned int max) {
+    u32 head = smp_load_acquire(&event_seq);    // Every slot before head is fully written
+    unsigned int taken = 0;
+
+    while (taken < max && reader->next_seq != head) {
+        const struct whackamole_event *slot = &event_log[reader->next_seq % EVENT_LOG_SIZE];
+        u32 oldest;
+
+        if (head - reader->next_seq < EVENT_LOG_SIZE && smp_load_acquire(&slot->seq) == reader->next_seq) {
+            events[taken] = *slot;
+            smp_rmb();      // Finish the copy before checking it was not overwritten meanwhile
+            if (READ_ONCE(slot->seq) == reader->next_seq) {
+                taken++;
+                WRITE_ONCE(reader->next_seq, reader->next_seq + 1);
+                continue;
+            }
+        }
+
+        // Lapped. The slot of head may be in the middle of a rewrite, so start right after it.
+        head = smp_load_acquire(&event_seq);
+        oldest = head - EVENT_LOG_SIZE + 1;
+        if ((s32)(oldest - reader->next_seq) > 0) {
+            reader->dropped += oldest - reader->next_seq;
+            WRITE_ONCE(reader->next_seq, oldest);
+        }
+    }
+    return taken;
+}
+
+/**
+ * Copies the reader's next events out of the log, waiting until there is at least one.
+ * A reader that fell too far behind skips to the oldest event still in the log and sees the
+ * gap in the sequence numbers. Other readers are not affected. No lock the writers take is
+ * ever held here, and nothing is held while the caller copies the events to user space.
+ *
+ * @param file The file being read, O_NONBLOCK makes the call return immediately.
+ * @param events Where to store the events.
+ * @param max Maximum number of events to take.
+ * @return The number of events taken, -EAGAIN if nothing is pending on a non-blocking file, or -ERESTARTSYS on a signal.
+ */
+static int take_events(struct file *file, struct whackamole_event *events, unsigned int max) {
+    struct event_reader *reader = file->private_data;
+    unsigned int taken;
+
+    for (;;) {
+        if (mutex_lock_interruptible(&reader->read_lock)) {
+            return -ERESTARTSYS;
+        }
+        taken = copy_events(reader, events, max);
+        if (taken) {
+            trace_whackamole_read(reader, events[0].seq, taken, reader->dropped);
+        }
+        mutex_unlock(&reader->read_lock);
+        if (taken) {
+            return taken;
+        }
+        if (file->f_flags & O_NONBLOCK) {
+            return -EAGAIN;     // Nothing to read and the caller does not want to wait
+        }
+        if (wait_event_interruptible(event_wait, events_pending(reader))) {
+            return -ERESTARTSYS;    // Interrupted by a signal while waiting
+        }
+    }
+}
+
+/**
+ * Gives taken events back to the reader when they could not be copied to user space, so the
+ * next read returns them again instead of losing them. Left alone if another thread read
+ * from the file in the meantime, it already moved on past them.
+ *
+ * @param file The file being read.
+ * @param events The events take_events() returned.
+ * @param taken The number of events taken.
+ * @param copied The number of them that did reach user space.
+ */
+static void untake_events(struct file *file, const struct whackamole_event *events, unsigned int taken, unsigned int copied) {
+    struct event_reader *reader = file->private_data;
+
+    mutex_lock(&reader->read_lock);
+    if (reader->next_seq == events[taken - 1].seq + 1) {
+        WRITE_ONCE(reader->next_seq, events[copied].seq);   // Overwritten meanwhile, the next read counts them as dropped
+    }
+    mutex_unlock(&reader->read_lock);
+}
+
+/**
+ * Reports readiness for poll(), select() and epoll on both the proc file and the device.
+ * The file is readable whenever this reader has events left to read, and always writable.
+ *
+ * @param file Pointer to the file structure
+ * @param wait Poll table the caller's wait queue entry is added to
+ * @return Mask of the currently ready events.
+ */
+static __poll_t event_poll(struct file *file, poll_table *wait) {
+    __poll_t mask = EPOLLOUT | EPOLLWRNORM;     // Commands can always be written
 
-    // Print successful IRQ setup
-    pr_info("IRQ for Button %d on GPIO %d with LED GPIO %d setup successfully\n", btn_index, btn_gpio, led_gpio);
-    return 0;   // return success
+    poll_wait(file, &event_wait, wait);     // Get woken up by the IRQ handler
+    if (events_pending(file->private_data)) {
+        mask |= EPOLLIN | EPOLLRDNORM;  // Button events are waiting to be read
+    }
+    return mask;
 }
 
 // ---------- PROC OPERATIONS ----------
 
+// Text names of the event types, indexed by enum whackamole_event_type
+static const char *const EVENT_NAMES[] = {
+    [WHACKAMOLE_EVENT_PRESS] = "pressed",
+    [WHACKAMOLE_EVENT_MOLE_SHOWN] = "shown",
+    [WHACKAMOLE_EVENT_HIT] = "hit",
+    [WHACKAMOLE_EVENT_MISS] = "missed",
+    [WHACKAMOLE_EVENT_TIMEOUT] = "timeout",
+    [WHACKAMOLE_EVENT_GAME_OVER] = "game_over",
+    [WHACKAMOLE_EVENT_PATTERN_DONE] = "pattern_done",
+    [WHACKAMOLE_EVENT_MOLE_HIDDEN] = "hidden",
+};
+
 /**
  * Reads data from the /proc file.
- * Function is called when a process reads from the proc file. It reads the 
- * contents of the kernel buffer (PROC_BUF) into the user buffer, ensuring that the 
- * user space receives the current state or last message logged in the buffer.
+ * Function is called when a process reads from the proc file. It returns the events this reader has not read yet,
+ * one line per event. Button presses keep the form "Button <index> pressed seq=<seq> t=<ns>",
+ * events of a game run by the kernel read "Mole <index> <what> score=<score> seq=<seq> t=<ns>".
+ * When no event is pending the call blocks until one arrives, unless the file
+ * was opened with O_NONBLOCK, so a reader can keep one fd open for the whole game.
+ * This text format is kept for compatibility, /dev/whackamole returns the raw records.
  *
  * @param file Pointer to the file structure
  * @param user_buffer Buffer in user space where data will be copied.
- * @param count Size of the user buffer
- * @param position Current position in the file, used to determine if there's more data to read.
- * @return The number of bytes copied if successful, 0 if there is no more data, or a negative error code.
+ * @param count Size of the user buffer, at least EVENT_LINE_SIZE.
+ * @param position Current position in the file
+ * @return The number of bytes copied if successful, -EAGAIN if nothing is pending on a non-blocking file, or a negative error code.
  */
 ssize_t procfile_read(struct file *file, char __user *user_buffer, size_t count, loff_t *position) {
-    int len = strlen(PROC_BUF);  // Get the length of the string in PROC_BUF
+    struct whackamole_event events[READ_BATCH];
+    char line[EVENT_LINE_SIZE];     // One formatted event
+    size_t copied = 0;      // Bytes copied to user space so far
+    int taken;
+    int len;
 
-    if (*position > 0) {
-        return 0;  // All data has been read, signify no more data to read
+    if (count < EVENT_LINE_SIZE) {
+        return -EINVAL;  // Buffer provided by user space is too small for a single event
     }
 
-    if (count < len) {
-        return -EFAULT;  // Buffer provided by user space is too small for data
+    taken = take_events(file, events, min_t(size_t, count / EVENT_LINE_SIZE, READ_BATCH));  // Every taken event is guaranteed to fit
+    if (taken < 0) {
+        return taken;
     }
 
-    mutex_lock(&lock);  // Lock the mutex to protect PROC_BUF from concurrent access
-    if (copy_to_user(user_buffer, PROC_BUF, len)) {
-        mutex_unlock(&lock);    // Unlock the mutex if copy fails
-        return -EFAULT;  // Failed to copy data to user space
+    for (int i = 0; i < taken; i++) {
+        const struct whackamole_event *event = &events[i];
+        if (event->type == WHACKAMOLE_EVENT_PRESS) {
+            len = snprintf(line, sizeof(line), "Button %u pressed seq=%u t=%llu\n",
+                           event->button, event->seq, (unsigned long long)event->timestamp_ns);
+        } else {
+            len = snprintf(line, sizeof(line), "Mole %u %s score=%d seq=%u t=%llu\n",
+                           event->button, event->type < ARRAY_SIZE(EVENT_NAMES) ? EVENT_NAMES[event->type] : "unknown",
+                           event->score, event->seq, (unsigned long long)event->timestamp_ns);
+        }
+        if (copy_to_user(user_buffer + copied, line, len)) {
+            untake_events(file, events, taken, i);  // The rest is read again next time
+            return copied ? copied : -EFAULT;  // Failed to copy data to user space
+        }
+        copied += len;
     }
+    *position += copied;   // Update the position for the next read operation
 
-    PROC_BUF[0] = '\0';  // Clear the buffer after successful  read
-    *position += len;   // Update the position for the next read operation
-    mutex_unlock(&lock);    // unlock mutex 
-
-    return len;  // Return the number of bytes read
+    return copied;  // Return the number of bytes read
 }
 
 /**
@@ -188,7 +1193,7 @@ ssize_t procfile_read(struct file *file, char __user *user_buffer, size_t count,
  * @return The number of bytes processed if successful, or a negative error code.
  */
 ssize_t procfile_write(struct file *file, const char __user *user_buffer, size_t count, loff_t *position) {
-    char command[20];	// Buffer to store command from user space
+    char command[PROC_COMMAND_SIZE];	// Buffer to store command from user space
     if (count > sizeof(command) - 1)
         return -EINVAL;	// Return invalid argument error if command is too long
 
@@ -199,65 +1204,403 @@ ssize_t procfile_write(struct file *file, const char __user *user_buffer, size_t
 
 	// Command to start the game
     if (strcmp(command, "GAME_START") == 0) {
-        gameActive = true;  // Set game as active
-        pr_info("Game started\n");
+        game_start();
     } else if (strcmp(command, "GAME_STOP") == 0) {
-        gameActive = false;  // Set game as inactive
-        for (int i = 0; i < 4; i++) {
-            gpio_set_value(GPIO_LEDS[i], 0);  // Turn off all LEDS when the game stops
-        }
-        pr_info("Game stopped\n");
+        game_stop();
     } else if (gameActive) {  // Handle LED commands only if the game is active
         if (strcmp(command, "red_ON") == 0) {
-            gpio_set_value(GPIO_LEDS[0], 1);	// Turn on the red LED
+            led_on(0);	// Turn on the red LED
         } else if (strcmp(command, "blue_ON") == 0) {
-            gpio_set_value(GPIO_LEDS[1], 1);	// Turn on the blue LED
+            led_on(1);	// Turn on the blue LED
         } else if (strcmp(command, "green_ON") == 0) {
-            gpio_set_value(GPIO_LEDS[2], 1);	// Turn on the green LED
+            led_on(2);	// Turn on the green LED
         } else if (strcmp(command, "yellow_ON") == 0) {
-            gpio_set_value(GPIO_LEDS[3], 1);	// Turn on the yellow LED
+            led_on(3);	// Turn on the yellow LED
         } else if (strcmp(command, "LED_OFF") == 0) {
-            for (int i = 0; i < 4; i++) {
-                gpio_set_value(GPIO_LEDS[i], 0);	// Turn off all LEDs
-            }
+            set_leds(0);	// Turn off all LEDs
+        } else if (strncmp(command, "LEDS=", 5) == 0) {
+            u64 mask;
+            if (kstrtou64(command + 5, 0, &mask))
+                return -EINVAL;	// Not a number
+            set_leds(mask);	// Set every LED at once, same as WHACKAMOLE_IOC_SET_LEDS
         }
     }
     return count;	// Return the number of bytes processed
 }
 
 
-// Initialize the module 
-static int __init my_module_init(void) {
-	
-	// For the proc file
-	memset(PROC_BUF,0,PROCFS_MAX_SIZE);	// Initialize the PROC_BUF with zeros to prepare it for use
-  	proc_create(PROCFS_NAME, 0666, NULL, &proc_fops);	// Create proc file
-  	pr_info("Proc init completed \n");
-
-	// "setup_button_irq" function initializes the GPIOs
-    for (int i = 0; i < NUM_BUTTONS; ++i) {
-        if (setup_button_irq(i) != 0) {
-            pr_info("Failed to initialize button %d\n", i);
-            return -1;  // Initialization failed
+/**
+ * Prints the latency table of /proc/whackamole_stats.
+ * One row per button with its presses, the presses that had a reaction time, and the
+ * p50/p95/p99 reaction times in microseconds. The layout is WHACKAMOLE_HIST_TABLE_HEADER,
+ * which the game also uses for its own dispatch latency.
+ *
+ * @param m The seq_file being generated.
+ * @param v Unused.
+ * @return 0
+ */
+static int stats_show(struct seq_file *m, void *v) {
+    unsigned long flags;
+    u32 presses, samples;
+    u64 p50, p95, p99;
+
+    seq_puts(m, WHACKAMOLE_HIST_TABLE_HEADER);
+    for (int i = 0; i < num_buttons; i++) {
+        spin_lock_irqsave(&lock, flags);    // Consistent snapshot of one button
+        presses = press_count[i];
+        samples = latency_count[i];
+        p50 = whackamole_hist_percentile(latency_hist[i], samples, 50);
+        p95 = whackamole_hist_percentile(latency_hist[i], samples, 95);
+        p99 = whackamole_hist_percentile(latency_hist[i], samples, 99);
+        spin_unlock_irqrestore(&lock, flags);
+        seq_printf(m, "%d %u %u %llu %llu %llu\n", i, presses, samples,
+                   (unsigned long long)p50, (unsigned long long)p95, (unsigned long long)p99);
+    }
+    return 0;
+}
+
+// Stats file is opened
+static int stats_open(struct inode *inode, struct file *file) {
+    return single_open(file, stats_show, NULL);
+}
+
+// stats fops struct
+static const struct proc_ops stats_fops = {
+    .proc_open = stats_open,
+    .proc_read = seq_read,
+    .proc_lseek = seq_lseek,
+    .proc_release = single_release,
+};
+
+// ---------- DEVICE OPERATIONS ----------
+
+/**
+ * Reads binary event records from /dev/whackamole.
+ * Copies as many whole struct whackamole_event records as fit in the user buffer,
+ * blocking until at least one is pending unless the file is non-blocking.
+ *
+ * @param file Pointer to the file structure
+ * @param user_buffer Buffer in user space where the records will be copied.
+ * @param count Size of the user buffer, at least one record.
+ * @param position Unused, the device is a stream.
+ * @return The number of bytes copied, or a negative error code.
+ */
+static ssize_t device_read(struct file *file, char __user *user_buffer, size_t count, loff_t *position) {
+    struct whackamole_event events[READ_BATCH];
+    int taken;
+
+    if (count < sizeof(struct whackamole_event)) {
+        return -EINVAL;     // Records are never split across reads
+    }
+
+    taken = take_events(file, events, min_t(size_t, count / sizeof(struct whackamole_event), READ_BATCH));
+    if (taken < 0) {
+        return taken;
+    }
+    if (copy_to_user(user_buffer, events, taken * sizeof(struct whackamole_event))) {
+        untake_events(file, events, taken, 0);  // Read again next time
+        return -EFAULT;     // Failed to copy data to user space
+    }
+    return taken * sizeof(struct whackamole_event);
+}
+
+/**
+ * Handles the game control ioctls declared in whackamole_uapi.h.
+ *
+ * @param file Pointer to the file structure
+ * @param cmd The ioctl number.
+ * @param arg The ioctl argument, a user pointer for commands that take one.
+ * @return 0 on success, -EFAULT if the argument cannot be copied, -EINVAL for bad engine rules or patterns, or -ENOTTY for unknown commands.
+ */
+static long device_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
+    struct whackamole_engine_config config;
+    struct whackamole_led_pattern pattern;
+    struct whackamole_board board = { .rows = rows, .cols = cols };
+    struct event_reader *reader = file->private_data;
+    u64 mask;
+
+    switch (cmd) {
+    case WHACKAMOLE_IOC_GAME_START:
+        game_start();
+        return 0;
+    case WHACKAMOLE_IOC_GAME_STOP:
+        game_stop();
+        return 0;
+    case WHACKAMOLE_IOC_SET_LEDS:
+        if (get_user(mask, (u64 __user *)arg)) {
+            return -EFAULT;
+        }
+        set_leds(mask);
+        return 0;
+    case WHACKAMOLE_IOC_ENGINE_START:
+        if (copy_from_user(&config, (void __user *)arg, sizeof(config))) {
+            return -EFAULT;
+        }
+        return engine_start(&config);
+    case WHACKAMOLE_IOC_GET_BOARD:
+        if (copy_to_user((void __user *)arg, &board, sizeof(board))) {
+            return -EFAULT;
+        }
+        return 0;
+    case WHACKAMOLE_IOC_GET_DROPPED:
+        return put_user(READ_ONCE(reader->dropped), (u32 __user *)arg);
+    case WHACKAMOLE_IOC_SET_PATTERN:
+        if (copy_from_user(&pattern, (void __user *)arg, sizeof(pattern))) {
+            return -EFAULT;
         }
+        return set_pattern(&pattern);
+    default:
+        return -ENOTTY;     // Not one of ours
+    }
+}
+
+// Every open of the device is a reader of its own
+static int device_open(struct inode *inode, struct file *file) {
+    return event_reader_open(file);
+}
+
+static int device_release(struct inode *inode, struct file *file) {
+    event_reader_release(file);
+    return 0;
+}
+
+// device fops struct
+static const struct file_operations device_fops = {
+    .owner = THIS_MODULE,
+    .open = device_open,
+    .release = device_release,
+    .read = device_read,
+    .poll = event_poll,
+    .unlocked_ioctl = device_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,
+    .llseek = noop_llseek,
+};
+
+static struct miscdevice whackamole_device = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name = WHACKAMOLE_DEVICE_NAME,
+    .fops = &device_fops,
+    .mode = 0666,   // Same access as the proc file
+};
+
+
+// ---------- PLATFORM DRIVER ----------
+// The module drives a "whackamole" platform device: one described by the device tree or, on
+// boards without such a node, one the module registers itself with a GPIO lookup table for the
+// pins given as parameters. Probe takes the GPIOs and IRQs device-managed, so any failure
+// unwinds everything requested before it and reloading the module never leaks a line.
+
+static struct platform_device *legacy_board;   // Device registered by the module itself, NULL if the device tree has the board
+static bool board_bound;   // A board is probed, the game state is global so there is only ever one
+static struct gpiod_lookup_table *legacy_lookup;    // Pins of legacy_board, NULL if the device tree has the board
+
+/**
+ * Turns a legacy GPIO number into a lookup entry, which names the chip and the line on it.
+ *
+ * @param entry Receives the entry.
+ * @param gpio GPIO number given at load time.
+ * @param con_id "led" or "button", the list the pin belongs to.
+ * @param idx Index of the pin in its list, the button it belongs to.
+ * @return 0 on success, -EINVAL if there is no such GPIO.
+ */
+static int legacy_lookup_entry(struct gpiod_lookup *entry, unsigned int gpio, const char *con_id, unsigned int idx) {
+    struct gpio_desc *desc = gpio_to_desc(gpio);
+    struct gpio_device *gdev;
+
+    if (!desc) {
+        pr_err("No GPIO %u for %s %u\n", gpio, con_id, idx);
+        return -EINVAL;
+    }
+    gdev = gpiod_to_gpio_device(desc);
+    *entry = (struct gpiod_lookup)GPIO_LOOKUP_IDX(gpio_device_get_label(gdev), gpio - gpio_device_get_base(gdev),
+                                                  con_id, idx, GPIO_ACTIVE_HIGH);
+    return 0;
+}
+
+/**
+ * Describes the pins given at load time as a GPIO lookup table of the "whackamole" device,
+ * so probe gets them through the same descriptor arrays as a device tree board.
+ *
+ * @return 0 on success, or a negative error code.
+ */
+static int legacy_lookup_add(void) {
+    unsigned int n = 0;
+    int retval = 0;
+
+    // One entry per pin and the empty one that ends the table
+    legacy_lookup = kzalloc(struct_size(legacy_lookup, table, num_led_gpios + num_btn_gpios + 1), GFP_KERNEL);
+    if (!legacy_lookup) {
+        return -ENOMEM;
+    }
+    legacy_lookup->dev_id = "whackamole";
+    for (unsigned int i = 0; !retval && i < num_led_gpios; i++) {
+        retval = legacy_lookup_entry(&legacy_lookup->table[n++], GPIO_LEDS[i], "led", i);
+    }
+    for (unsigned int i = 0; !retval && i < num_btn_gpios; i++) {
+        retval = legacy_lookup_entry(&legacy_lookup->table[n++], GPIO_BTNS[i], "button", i);
+    }
+    if (retval) {
+        kfree(legacy_lookup);
+        legacy_lookup = NULL;
+        return retval;
+    }
+    gpiod_add_lookup_table(legacy_lookup);
+    return 0;
+}
+
+// Drops the lookup table of the pins given at load time, once nothing can probe with it
+static void legacy_lookup_remove(void) {
+    if (legacy_lookup) {
+        gpiod_remove_lookup_table(legacy_lookup);
+        kfree(legacy_lookup);
+        legacy_lookup = NULL;
+    }
+}
+
+/**
+ * Brings up the board: GPIOs, IRQs, then the proc files and the device, so nothing is
+ * visible to user space before the hardware is ready.
+ *
+ * @param pdev The board.
+ * @return 0 on success, or a negative error code with everything released again.
+ */
+static int whackamole_probe(struct platform_device *pdev) {
+    struct device *dev = &pdev->dev;
+    int retval;
+
+    if (board_bound) {
+        return -EBUSY;
+    }
+
+    // A device tree board may give its own size, the parameters are the default
+    device_property_read_u32(dev, "rows", &rows);
+    device_property_read_u32(dev, "cols", &cols);
+    // Checked one by one before multiplying, a product that wraps could look like a small board
+    if (!rows || !cols || rows > MAX_BUTTONS / cols) {
+        dev_err(dev, "Board %ux%u is not supported, at most %u buttons\n", rows, cols, MAX_BUTTONS);
+        return -EINVAL;
+    }
+    num_buttons = rows * cols;
+
+    retval = board_get_gpios(dev);
+    if (retval) {
+        return retval;
+    }
+    retval = board_request_irqs(dev);
+    if (retval) {
+        return retval;
+    }
+
+    // For the proc file
+    if (!proc_create(PROCFS_NAME, 0666, NULL, &proc_fops)) {
+        return -ENOMEM;
     }
-    
-    pr_info("Module initialized successfully\n");
+    if (!proc_create(STATS_PROCFS_NAME, 0444, NULL, &stats_fops)) {
+        retval = -ENOMEM;
+        goto err_proc;
+    }
+    // Binary interface next to the proc file
+    retval = misc_register(&whackamole_device);
+    if (retval) {
+        dev_err(dev, "Unable to register /dev/%s\n", WHACKAMOLE_DEVICE_NAME);
+        goto err_stats;
+    }
+
+    board_bound = true;
+    dev_info(dev, "Board %ux%u ready\n", rows, cols);
     return 0;
+
+err_stats:
+    remove_proc_entry(STATS_PROCFS_NAME, NULL);
+err_proc:
+    remove_proc_entry(PROCFS_NAME, NULL);
+    return retval;
+}
+
+// Takes the interfaces away and stops the game, the IRQs and GPIOs are released right after
+static void whackamole_remove(struct platform_device *pdev) {
+    misc_deregister(&whackamole_device);	// removing /dev/whackamole
+    remove_proc_entry(STATS_PROCFS_NAME, NULL);	// removing stats file
+    remove_proc_entry(PROCFS_NAME, NULL);	// removing proc file
+    game_stop();	// Stops the engine timers and turns the LEDs off
+    hrtimer_cancel(&pattern_timer);	// Nothing can start a pattern anymore
+    flush_work(&led_work);	// LEDs are off before their GPIOs are released
+    board_bound = false;
+}
+
+static const struct of_device_id whackamole_of_match[] = {
+    { .compatible = "whackamole,board" },
+    { }
+};
+MODULE_DEVICE_TABLE(of, whackamole_of_match);
+
+static struct platform_driver whackamole_driver = {
+    .probe = whackamole_probe,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 11, 0)
+    .remove = whackamole_remove,
+#else
+    .remove_new = whackamole_remove,   // .remove returned int before 6.11
+#endif
+    .driver = {
+        .name = "whackamole",
+        .of_match_table = whackamole_of_match,
+        .suppress_bind_attrs = true,    // Only unloading the module takes the board away, never while a file is open
+    },
+};
+
+// Initialize the module 
+static int __init my_module_init(void) {
+	struct device_node *np;
+	int retval;
+
+	engine_init();	// Timers of the kernel-run game
+	patterns_init();	// Timer of the LED patterns
+
+	retval = platform_driver_register(&whackamole_driver);
+	if (retval) {
+		return retval;
+	}
+
+	// A board in the device tree probes on its own, also later if its GPIO chips are not ready yet
+	np = of_find_matching_node(NULL, whackamole_of_match);
+	of_node_put(np);
+	if (np) {
+		pr_info("Module initialized, board from the device tree\n");
+		return 0;
+	}
+
+	// Otherwise describe the board with the pins given at load time
+	retval = legacy_lookup_add();
+	if (retval) {
+		platform_driver_unregister(&whackamole_driver);
+		return retval;
+	}
+	legacy_board = platform_device_register_simple("whackamole", PLATFORM_DEVID_NONE, NULL, 0);
+	if (IS_ERR(legacy_board)) {
+		retval = PTR_ERR(legacy_board);
+		legacy_board = NULL;
+		legacy_lookup_remove();
+		platform_driver_unregister(&whackamole_driver);
+		return retval;
+	}
+	if (!board_bound) {	// Probe failed and already released everything, the reason is in the log
+		platform_device_unregister(legacy_board);
+		legacy_lookup_remove();
+		platform_driver_unregister(&whackamole_driver);
+		return -ENODEV;
+	}
+	pr_info("Module initialized successfully\n");
+	return 0;
 }
 
 // Exit the module
 static void __exit my_module_exit(void) {
-	remove_proc_entry(PROCFS_NAME, NULL);	// removing proc file
-	
-	// free the IRQ and GPIOs 
-    for (int i = 0; i < NUM_BUTTONS; ++i) {
-        free_irq(irq_numbers[i], (void *)(size_t)i);    // Free the IRQ assigned to button using the button's LED GPIO as the device ID
-        gpio_free(GPIO_BTNS[i]);
-        gpio_free(GPIO_LEDS[i]);
-        irq_requested[i] = false; // Mark as free
-    }
-    pr_info("Module exited successfully\n");
+	if (legacy_board) {
+		platform_device_unregister(legacy_board);	// Runs whackamole_remove()
+	}
+	legacy_lookup_remove();
+	platform_driver_unregister(&whackamole_driver);
+	pr_info("Module exited successfully\n");
 }
 
 module_init(my_module_init);
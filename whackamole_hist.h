@@ -0,0 +1,99 @@
+/*
+ * Log-linear latency histogram buckets.
+ * Shared by final_project_proc.c and the Qt game, so the kernel's
+ * /proc/whackamole_stats and the GUI's own measurements use identical buckets.
+ *
+ * Values are in microseconds. Below WHACKAMOLE_HIST_SUB every microsecond has its own
+ * bucket, above it every power of two is split into WHACKAMOLE_HIST_SUB equal buckets,
+ * which keeps the relative error under 1/WHACKAMOLE_HIST_SUB up to about 16 seconds.
+ */
+#ifndef WHACKAMOLE_HIST_H
+#define WHACKAMOLE_HIST_H
+
+#include <linux/types.h>
+
+#define WHACKAMOLE_HIST_SUB_BITS	3		// Linear sub-buckets per power of two, as a power of two
+#define WHACKAMOLE_HIST_SUB		(1u << WHACKAMOLE_HIST_SUB_BITS)
+#define WHACKAMOLE_HIST_MAX_BITS	24		// Values of 2^24 us (~16.7 s) and above share the last bucket
+#define WHACKAMOLE_HIST_BUCKETS	((WHACKAMOLE_HIST_MAX_BITS - WHACKAMOLE_HIST_SUB_BITS + 1) * WHACKAMOLE_HIST_SUB)
+
+// Header of the latency table, every row is "<button> <presses> <samples> <p50> <p95> <p99>"
+#define WHACKAMOLE_HIST_TABLE_HEADER	"button presses samples p50_us p95_us p99_us\n"
+
+/**
+ * Maps a latency to its bucket.
+ *
+ * @param value_us Latency in microseconds.
+ * @return Bucket index, below WHACKAMOLE_HIST_BUCKETS.
+ */
+static inline unsigned int whackamole_hist_bucket(__u64 value_us)
+{
+    unsigned int msb;
+
+    if (value_us < WHACKAMOLE_HIST_SUB)
+        return (unsigned int)value_us;     // Exact buckets for tiny values
+    msb = 63 - __builtin_clzll(value_us);
+    if (msb >= WHACKAMOLE_HIST_MAX_BITS)
+        return WHACKAMOLE_HIST_BUCKETS - 1;     // Clamp outliers
+    return (msb - WHACKAMOLE_HIST_SUB_BITS + 1) * WHACKAMOLE_HIST_SUB
+         + (unsigned int)((value_us >> (msb - WHACKAMOLE_HIST_SUB_BITS)) & (WHACKAMOLE_HIST_SUB - 1));
+}
+
+/**
+ * Returns the largest latency that maps to a bucket, used when reporting percentiles.
+ *
+ * @param bucket Bucket index.
+ * @return Upper bound of the bucket in microseconds.
+ */
+static inline __u64 whackamole_hist_bucket_max(unsigned int bucket)
+{
+    unsigned int group = bucket / WHACKAMOLE_HIST_SUB;
+    unsigned int sub = bucket % WHACKAMOLE_HIST_SUB;
+
+    if (group == 0)
+        return bucket;
+    return (((__u64)(WHACKAMOLE_HIST_SUB + sub + 1)) << (group - 1)) - 1;
+}
+
+/**
+ * Computes a percentile from bucket counts.
+ * The percentile is the first bucket where seen * 100 reaches count * percent. Both sides are
+ * 64-bit, so large counts don't wrap, and there is no 64-bit division for 32-bit kernels.
+ *
+ * @param buckets WHACKAMOLE_HIST_BUCKETS counters.
+ * @param count Sum of all counters.
+ * @param percent Percentile to compute, 1 to 100.
+ * @return Upper bound of the bucket holding the percentile in microseconds, 0 if the histogram is empty.
+ */
+static inline __u64 whackamole_hist_percentile(const __u32 *buckets, __u32 count, unsigned int percent)
+{
+    __u64 target = (__u64)count * percent;
+    __u64 seen = 0;
+
+    if (count == 0)
+        return 0;
+    for (unsigned int i = 0; i < WHACKAMOLE_HIST_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen * 100 >= target)
+            return whackamole_hist_bucket_max(i);
+    }
+    return whackamole_hist_bucket_max(WHACKAMOLE_HIST_BUCKETS - 1);
+}
+
+// Same as whackamole_hist_percentile() for 64-bit counters, e.g. totals over many sessions
+static inline __u64 whackamole_hist_percentile64(const __u64 *buckets, __u64 count, unsigned int percent)
+{
+    __u64 target = count * percent;
+    __u64 seen = 0;
+
+    if (count == 0)
+        return 0;
+    for (unsigned int i = 0; i < WHACKAMOLE_HIST_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen * 100 >= target)
+            return whackamole_hist_bucket_max(i);
+    }
+    return whackamole_hist_bucket_max(WHACKAMOLE_HIST_BUCKETS - 1);
+}
+
+#endif // WHACKAMOLE_HIST_H
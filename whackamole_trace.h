@@ -0,0 +1,99 @@
+/*
+ * Tracepoints of the whack-a-mole kernel module.
+ * They cost a patched-out branch while disabled. Enable them with ftrace or perf, e.g.
+ *   echo 1 > /sys/kernel/tracing/events/whackamole/enable
+ *   perf record -e 'whackamole:*' -a
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM whackamole
+
+#if !defined(WHACKAMOLE_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define WHACKAMOLE_TRACE_H
+
+#include <linux/tracepoint.h>
+
+// A button IRQ reached its thread, before debouncing
+TRACE_EVENT(whackamole_irq,
+    TP_PROTO(int button, u64 stamp_ns),
+    TP_ARGS(button, stamp_ns),
+    TP_STRUCT__entry(
+        __field(int, button)
+        __field(u64, stamp_ns)      // Time of the press, taken in the hard handler
+    ),
+    TP_fast_assign(
+        __entry->button = button;
+        __entry->stamp_ns = stamp_ns;
+    ),
+    TP_printk("button=%d stamp_ns=%llu", __entry->button, __entry->stamp_ns)
+);
+
+// A press was ignored because the button was still inside its debounce window
+TRACE_EVENT(whackamole_debounce_reject,
+    TP_PROTO(int button, u64 now_ns, u64 last_ns),
+    TP_ARGS(button, now_ns, last_ns),
+    TP_STRUCT__entry(
+        __field(int, button)
+        __field(u64, since_ns)      // Time since the last accepted press
+    ),
+    TP_fast_assign(
+        __entry->button = button;
+        __entry->since_ns = now_ns - last_ns;
+    ),
+    TP_printk("button=%d since_ns=%llu", __entry->button, __entry->since_ns)
+);
+
+// One LED was switched
+TRACE_EVENT(whackamole_led_set,
+    TP_PROTO(int led, int on),
+    TP_ARGS(led, on),
+    TP_STRUCT__entry(
+        __field(int, led)
+        __field(int, on)
+    ),
+    TP_fast_assign(
+        __entry->led = led;
+        __entry->on = on;
+    ),
+    TP_printk("led=%d on=%d", __entry->led, __entry->on)
+);
+
+// Every LED of the board was set at once
+TRACE_EVENT(whackamole_leds_set,
+    TP_PROTO(u64 mask),
+    TP_ARGS(mask),
+    TP_STRUCT__entry(
+        __field(u64, mask)
+    ),
+    TP_fast_assign(
+        __entry->mask = mask;
+    ),
+    TP_printk("mask=%#llx", __entry->mask)
+);
+
+// A reader took events out of the log
+TRACE_EVENT(whackamole_read,
+    TP_PROTO(const void *reader, u32 first_seq, unsigned int count, u32 dropped),
+    TP_ARGS(reader, first_seq, count, dropped),
+    TP_STRUCT__entry(
+        __field(const void *, reader)   // Identifies the open file
+        __field(u32, first_seq)         // Sequence number of the first event taken
+        __field(unsigned int, count)
+        __field(u32, dropped)           // Events this reader missed so far
+    ),
+    TP_fast_assign(
+        __entry->reader = reader;
+        __entry->first_seq = first_seq;
+        __entry->count = count;
+        __entry->dropped = dropped;
+    ),
+    TP_printk("reader=%p first_seq=%u count=%u dropped=%u",
+              __entry->reader, __entry->first_seq, __entry->count, __entry->dropped)
+);
+
+#endif // WHACKAMOLE_TRACE_H
+
+// Must stay outside the include guard, <trace/define_trace.h> reads this file again
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE whackamole_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,99 @@
+/*
+ * Binary interface of the whack-a-mole kernel module.
+ * Shared by final_project_proc.c and the Qt game, so both sides agree on the
+ * layout of the records read from /dev/whackamole and on the ioctl numbers.
+ */
+#ifndef WHACKAMOLE_UAPI_H
+#define WHACKAMOLE_UAPI_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define WHACKAMOLE_DEVICE_NAME "whackamole"		// Character device, appears as /dev/whackamole
+#define WHACKAMOLE_MAX_BUTTONS 64		// Largest supported board (8x8), one bit per LED in a __u64 mask
+
+// Kinds of records returned by read()
+enum whackamole_event_type {
+    WHACKAMOLE_EVENT_PRESS = 0,		// A button was pressed while the game was active
+    // Only sent while the kernel runs the game itself, see WHACKAMOLE_IOC_ENGINE_START
+    WHACKAMOLE_EVENT_MOLE_SHOWN,	// A mole popped up under the button
+    WHACKAMOLE_EVENT_HIT,		// The mole under the button was whacked in time
+    WHACKAMOLE_EVENT_MISS,		// The button was pressed with no mole under it
+    WHACKAMOLE_EVENT_TIMEOUT,		// The mole under the button went away without being whacked
+    WHACKAMOLE_EVENT_GAME_OVER,		// The round ended, score is final
+    WHACKAMOLE_EVENT_PATTERN_DONE,	// The LED pattern of the button ran to its end, see WHACKAMOLE_IOC_SET_PATTERN
+    WHACKAMOLE_EVENT_MOLE_HIDDEN,	// The oldest mole went away, no score change, to make room for a new one
+};
+
+/**
+ * One record returned by read() on /dev/whackamole.
+ * read() only ever returns whole records. Every open file gets every event from the time it
+ * was opened, independently of other readers. The sequence number increments on every
+ * event, so a gap tells the reader it fell too far behind and missed events.
+ */
+struct whackamole_event {
+    __u32 seq;              // Sequence number of this event
+    __u16 type;             // enum whackamole_event_type
+    __u16 button;           // Index of the button the event refers to
+    __u64 timestamp_ns;     // CLOCK_MONOTONIC time of the event, in nanoseconds
+    __s32 score;            // Score after the event while the kernel runs the game, 0 otherwise
+    __u32 latency_us;       // Reaction time for presses on a lit LED, 0 otherwise
+};
+
+/**
+ * Rules of a game run by the kernel, see WHACKAMOLE_IOC_ENGINE_START.
+ * Every duration must be nonzero. Every mole has its own window, so with max_moles above 1
+ * several moles are up at once and presses are judged per button.
+ */
+struct whackamole_engine_config {
+    __u32 duration_ms;          // Length of the round
+    __u32 spawn_interval_ms;    // Time between two moles popping up
+    __u32 mole_window_ms;       // How long a mole stays up
+    __s32 hit_points;           // Score change when the lit button is pressed
+    __s32 miss_points;          // Score change when an unlit button is pressed
+    __s32 timeout_points;       // Score change when a mole goes away untouched
+    __u32 max_moles;            // Moles up at the same time, 0 counts as 1, capped at the board size
+};
+
+// Layout of the board, see WHACKAMOLE_IOC_GET_BOARD. Buttons are numbered row by row.
+struct whackamole_board {
+    __u32 rows;
+    __u32 cols;
+};
+
+// Kinds of LED patterns, see struct whackamole_led_pattern
+enum whackamole_pattern_kind {
+    WHACKAMOLE_PATTERN_NONE = 0,	// Stop the pattern of the LED, it goes back to the state the game set
+    WHACKAMOLE_PATTERN_BLINK,		// on_ms lit and off_ms dark, repeat times
+    WHACKAMOLE_PATTERN_HIT_FLASH,	// Three short bright flashes, about 240 ms, timing fixed by the module
+    WHACKAMOLE_PATTERN_MISS_FLASH,	// One dim 150 ms flash, timing fixed by the module
+    WHACKAMOLE_PATTERN_DIM,		// Lit at the given brightness until replaced
+};
+
+/**
+ * Animation of one LED, see WHACKAMOLE_IOC_SET_PATTERN.
+ * While a pattern runs it owns the LED, LED commands for it only change the state the LED
+ * goes back to when the pattern ends. A new pattern for the same LED replaces the old one.
+ * Brightness below 255 is software PWM at 200 Hz during the lit phases.
+ */
+struct whackamole_led_pattern {
+    __u8 led;               // Index of the LED
+    __u8 kind;              // enum whackamole_pattern_kind
+    __u8 brightness;        // Brightness of the lit phases of BLINK and DIM, 0 dark to 255 full
+    __u8 reserved;          // Must be 0
+    __u16 on_ms;            // Lit phase of a BLINK cycle, nonzero
+    __u16 off_ms;           // Dark phase of a BLINK cycle, 0 for none
+    __u32 repeat;           // # of BLINK cycles, 0 to blink until replaced
+};
+
+#define WHACKAMOLE_IOC_MAGIC 'W'
+
+#define WHACKAMOLE_IOC_GAME_START	_IO(WHACKAMOLE_IOC_MAGIC, 0x01)			// Accept button presses
+#define WHACKAMOLE_IOC_GAME_STOP	_IO(WHACKAMOLE_IOC_MAGIC, 0x02)			// Ignore button presses and turn every LED off
+#define WHACKAMOLE_IOC_SET_LEDS		_IOW(WHACKAMOLE_IOC_MAGIC, 0x03, __u64)	// Bit i of the mask drives LED i, ignored while the game is stopped or run by the kernel
+#define WHACKAMOLE_IOC_ENGINE_START	_IOW(WHACKAMOLE_IOC_MAGIC, 0x04, struct whackamole_engine_config)	// Start a game run entirely by the kernel, GAME_STOP ends it early
+#define WHACKAMOLE_IOC_GET_BOARD	_IOR(WHACKAMOLE_IOC_MAGIC, 0x05, struct whackamole_board)	// Size of the board the module was loaded for
+#define WHACKAMOLE_IOC_GET_DROPPED	_IOR(WHACKAMOLE_IOC_MAGIC, 0x06, __u32)	// # of events this open file missed because it fell behind
+#define WHACKAMOLE_IOC_SET_PATTERN	_IOW(WHACKAMOLE_IOC_MAGIC, 0x07, struct whackamole_led_pattern)	// Play a pattern on one LED, ignored while the game is stopped
+
+#endif // WHACKAMOLE_UAPI_H